@@ -0,0 +1,67 @@
+#pragma once
+
+#include <lib/maps/blocking_hash_map.hpp>
+
+namespace bench {
+
+// Per-operation latency percentiles, in nanoseconds
+struct LatencyReport {
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+};
+
+namespace {
+
+namespace impl {
+
+inline LatencyReport percentiles(std::vector<uint64_t>& samples) {
+    REQUIRE(!samples.empty(), "No latency samples");
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) {
+        return samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))];
+    };
+    return {at(0.5), at(0.99), at(0.999), samples.back()};
+}
+
+}  // impl
+
+} // namespace
+
+// Every thread inserts its own range of fresh keys into a map that starts with the smallest
+// possible table, so the run crosses every resize on the way to `keys` entries.
+inline LatencyReport insertLatency(uint64_t threads, uint64_t keys) {
+    concurrent_hash_map<uint64_t, uint64_t> map;
+    std::vector<std::vector<uint64_t>> samples(threads);
+    std::vector<std::thread> workers;
+
+    uint64_t perThread = keys / threads;
+    for (uint64_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&map, &samples, perThread, t] {
+            auto& local = samples[t];
+            local.reserve(perThread);
+            for (uint64_t key = t * perThread; key < (t + 1) * perThread; ++key) {
+                auto start = std::chrono::steady_clock::now();
+                map.insert({key, key});
+                auto end = std::chrono::steady_clock::now();
+                local.push_back(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                                .count()));
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<uint64_t> all;
+    all.reserve(perThread * threads);
+    for (auto& local : samples) {
+        all.insert(all.end(), local.begin(), local.end());
+    }
+    return impl::percentiles(all);
+}
+
+}  // bench
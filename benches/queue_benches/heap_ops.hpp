@@ -0,0 +1,31 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <lib/queues/uniQueue.hpp>
+#include <lib/queues/dary_heap.hpp>
+#include <lib/queues/minmax_heap.hpp>
+
+namespace bench {
+
+// Nanoseconds per pop + push pair on a heap holding `size` random keys (the hold model: a
+// timer heap at a steady size, where each fired entry is replaced by a new one)
+template <typename HeapT>
+inline double heapHoldNs(uint64_t size, uint64_t ops) {
+    std::mt19937_64 gen(size);
+    HeapT heap;
+    for (uint64_t i = 0; i < size; ++i) {
+        heap.h_insert(gen());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        benchmark::DoNotOptimize(heap.h_pop_top());
+        heap.h_insert(gen());
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+    return static_cast<double>(elapsed.count()) / static_cast<double>(ops);
+}
+
+} // namespace bench
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <benches/queue_benches/queue_throughput.hpp>
+
+namespace bench {
+
+// Heap allocations of the whole process. Bumped by the replaced global operator new of the
+// benchmark binary (bin/alloc_counter.cpp), stays 0 if the binary does not replace it.
+inline std::atomic<uint64_t> allocations{0};
+
+struct AllocReport {
+    double allocsPerItem;
+    double nsPerItem;
+};
+
+// Allocations per item that went through the queue. A warm-up round runs first, so node
+// caches that recycle memory are measured in their steady state.
+template <typename QueueT>
+inline AllocReport queueAllocations(uint64_t producers, uint64_t consumers, uint64_t items) {
+    QueueT queue;
+    impl::pumpItems(queue, producers, consumers, items);
+
+    uint64_t before = allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    impl::pumpItems(queue, producers, consumers, items);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    uint64_t allocs = allocations.load(std::memory_order_relaxed) - before;
+
+    return {static_cast<double>(allocs) / static_cast<double>(items),
+            static_cast<double>(ns) / static_cast<double>(items)};
+}
+
+} // namespace bench
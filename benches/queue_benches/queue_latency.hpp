@@ -0,0 +1,60 @@
+#pragma once
+
+#include <benches/map_benches/map_latency.hpp>
+#include <benches/queue_benches/queue_throughput.hpp>
+
+namespace bench {
+
+// Latency of every enqueue and of every successful dequeue while `producers` and `consumers`
+// threads share one queue of uint64_t. The tail shows how long a single call can be held up
+// by retries or helping.
+template <typename QueueT>
+inline LatencyReport queueLatency(uint64_t producers, uint64_t consumers, uint64_t items) {
+    QueueT queue;
+    std::atomic<uint64_t> consumed{0};
+    std::vector<std::vector<uint64_t>> samples(producers + consumers);
+    std::vector<std::thread> workers;
+
+    auto elapsed = [](auto start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now() - start)
+                                             .count());
+    };
+
+    uint64_t perProducer = items / producers;
+    uint64_t total = perProducer * producers;
+    for (uint64_t p = 0; p < producers; ++p) {
+        workers.emplace_back([&, p] {
+            auto& local = samples[p];
+            local.reserve(perProducer);
+            for (uint64_t i = 0; i < perProducer; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                queue.enqueue(uint64_t{i});
+                local.push_back(elapsed(start));
+            }
+        });
+    }
+    for (uint64_t c = 0; c < consumers; ++c) {
+        workers.emplace_back([&, c] {
+            auto& local = samples[producers + c];
+            uint64_t item;
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                auto start = std::chrono::steady_clock::now();
+                if (queue.dequeue(item)) {
+                    local.push_back(elapsed(start));
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    impl::finish(queue, workers, producers);
+
+    std::vector<uint64_t> all;
+    all.reserve(2 * total);
+    for (auto& local : samples) {
+        all.insert(all.end(), local.begin(), local.end());
+    }
+    return impl::percentiles(all);
+}
+
+}  // bench
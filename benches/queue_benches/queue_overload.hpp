@@ -0,0 +1,54 @@
+#pragma once
+
+#include <benches/queue_benches/queue_throughput.hpp>
+#include <ctime>
+
+namespace bench {
+
+struct OverloadReport {
+    double itemsPerSec;
+    // process CPU time over wall time, i.e. the number of cores kept busy
+    double busyCores;
+};
+
+// Producers outpace a single consumer that works `perItem` on every item, so the queue stays
+// full and producers spend almost all of their time waiting for room.
+template <typename QueueT>
+inline OverloadReport queueOverload(uint64_t producers, uint64_t items,
+                                    std::chrono::nanoseconds perItem) {
+    QueueT queue;
+    std::vector<std::thread> workers;
+    uint64_t perProducer = items / producers;
+
+    std::clock_t cpuStart = std::clock();
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t p = 0; p < producers; ++p) {
+        workers.emplace_back([&queue, perProducer] {
+            for (uint64_t i = 0; i < perProducer; ++i) {
+                queue.enqueue(uint64_t{i});
+            }
+        });
+    }
+    workers.emplace_back([&queue, perItem, total = perProducer * producers] {
+        uint64_t item;
+        for (uint64_t done = 0; done < total;) {
+            if (!queue.dequeue(item)) {
+                continue;
+            }
+            ++done;
+            auto until = std::chrono::steady_clock::now() + perItem;
+            while (std::chrono::steady_clock::now() < until) {
+            }
+        }
+    });
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpuSec = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    return {static_cast<double>(perProducer * producers) / wallSec, cpuSec / wallSec};
+}
+
+} // namespace bench
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <benches/queue_benches/queue_throughput.hpp>
+
+namespace bench {
+
+// One binary heap behind one mutex, the baseline for concurrent priority queues
+template <typename TaskT>
+class LockedHeap {
+private:
+    std::mutex mut_;
+    BinHeap<TaskT> heap_;
+
+public:
+    void enqueue(TaskT&& task) {
+        std::lock_guard<std::mutex> guard{mut_};
+        heap_.h_insert(std::move(task));
+    }
+
+    bool dequeue(TaskT& task) {
+        std::lock_guard<std::mutex> guard{mut_};
+        if (heap_.empty()) {
+            return false;
+        }
+        task = heap_.h_pop_top();
+        return true;
+    }
+};
+
+// Mean number of higher-priority items still queued when an item is dequeued, measured by one
+// thread draining a queue filled with a random permutation of `items` priorities
+template <typename QueueT>
+inline double queueRankError(uint64_t items, uint64_t samples) {
+    QueueT queue;
+    std::vector<uint64_t> prios(items);
+    std::iota(prios.begin(), prios.end(), 0);
+    std::shuffle(prios.begin(), prios.end(), std::mt19937_64(items));
+    for (uint64_t prio : prios) {
+        queue.enqueue(uint64_t{prio});
+    }
+
+    std::set<uint64_t> queued(prios.begin(), prios.end());
+    uint64_t errors = 0;
+    uint64_t taken = 0;
+    uint64_t prio;
+    while (taken < samples && queue.dequeue(prio)) {
+        auto it = queued.find(prio);
+        errors += static_cast<uint64_t>(std::distance(it, queued.end())) - 1;
+        queued.erase(it);
+        ++taken;
+    }
+    return taken == 0 ? 0 : static_cast<double>(errors) / static_cast<double>(taken);
+}
+
+} // namespace bench
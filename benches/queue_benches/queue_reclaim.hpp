@@ -0,0 +1,60 @@
+#pragma once
+
+#include <benches/queue_benches/queue_throughput.hpp>
+
+namespace bench {
+
+struct ReclaimReport {
+    double nsPerOp;
+    // retired nodes not freed yet, sampled by every thread now and then
+    uint64_t peakPending;
+    double meanPending;
+};
+
+// Every thread runs enqueue/dequeue pairs on a queue built with the reclamation policy ReclaimT
+// and passes a quiescent state every quiescentEvery pairs, as a worker does between tasks
+template <typename QueueT, typename ReclaimT>
+inline ReclaimReport queueReclaim(uint64_t threads, uint64_t pairs, uint64_t quiescentEvery) {
+    constexpr uint64_t SAMPLE_EVERY = 1024;
+
+    QueueT queue;
+    std::atomic<uint64_t> peak{0};
+    std::atomic<uint64_t> sampleSum{0};
+    std::atomic<uint64_t> samples{0};
+    uint64_t perThread = pairs / threads;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (uint64_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            uint64_t task;
+            for (uint64_t i = 1; i <= perThread; ++i) {
+                queue.enqueue(uint64_t{i});
+                queue.dequeue(task);
+                if (i % quiescentEvery == 0) {
+                    ReclaimT::Quiescent();
+                }
+                if (i % SAMPLE_EVERY == 0) {
+                    uint64_t pending = ReclaimT::Pending();
+                    sampleSum.fetch_add(pending, std::memory_order_relaxed);
+                    samples.fetch_add(1, std::memory_order_relaxed);
+                    uint64_t seen = peak.load(std::memory_order_relaxed);
+                    while (pending > seen && !peak.compare_exchange_weak(seen, pending)) {
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+    uint64_t sampled = std::max<uint64_t>(samples.load(), 1);
+    return {static_cast<double>(ns) / static_cast<double>(2 * perThread * threads), peak.load(),
+            static_cast<double>(sampleSum.load()) / static_cast<double>(sampled)};
+}
+
+} // namespace bench
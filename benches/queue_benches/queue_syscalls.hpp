@@ -0,0 +1,40 @@
+#pragma once
+
+#include <benches/queue_benches/queue_throughput.hpp>
+#include <sys/resource.h>
+
+namespace bench {
+
+struct SyscallReport {
+    double itemsPerSec;
+    // futex waits and wakes made by the queue
+    double futexPerMop;
+    // voluntary context switches of the whole process, covers mutexes and condvars too
+    double switchesPerMop;
+};
+
+// Kernel entries per million items that went through the queue
+template <typename QueueT>
+inline SyscallReport queueSyscalls(uint64_t producers, uint64_t consumers, uint64_t items) {
+    QueueT queue;
+    rusage before{};
+    getrusage(RUSAGE_SELF, &before);
+    uint64_t futexBefore = futex::syscalls.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    impl::pumpItems(queue, producers, consumers, items);
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    uint64_t futexCalls = futex::syscalls.load(std::memory_order_relaxed) - futexBefore;
+    rusage after{};
+    getrusage(RUSAGE_SELF, &after);
+
+    double mops = static_cast<double>(items) / 1e6;
+    return {static_cast<double>(items) * 1e9 / static_cast<double>(ns),
+            static_cast<double>(futexCalls) / mops,
+            static_cast<double>(after.ru_nvcsw - before.ru_nvcsw) / mops};
+}
+
+} // namespace bench
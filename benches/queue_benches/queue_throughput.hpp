@@ -0,0 +1,110 @@
+#pragma once
+
+#include <lib/queues/uniQueue.hpp>
+
+namespace bench {
+
+namespace {
+
+namespace impl {
+
+// Joins the producers, releases consumers blocked on an empty queue, then joins the consumers
+template <typename QueueT>
+inline void finish(QueueT& queue, std::vector<std::thread>& workers, uint64_t producers) {
+    for (uint64_t p = 0; p < producers; ++p) {
+        workers[p].join();
+    }
+    if constexpr (requires { queue.wakeUp(); }) {
+        queue.wakeUp();
+    }
+    for (uint64_t w = producers; w < workers.size(); ++w) {
+        workers[w].join();
+    }
+}
+
+// Producers push `items` values in total, consumers pop until all of them are through
+template <typename QueueT>
+inline void pumpItems(QueueT& queue, uint64_t producers, uint64_t consumers, uint64_t items) {
+    std::atomic<uint64_t> consumed{0};
+    std::vector<std::thread> workers;
+
+    uint64_t perProducer = items / producers;
+    for (uint64_t p = 0; p < producers; ++p) {
+        workers.emplace_back([&queue, perProducer] {
+            for (uint64_t i = 0; i < perProducer; ++i) {
+                queue.enqueue(uint64_t{i});
+            }
+        });
+    }
+    for (uint64_t c = 0; c < consumers; ++c) {
+        workers.emplace_back([&queue, &consumed, total = perProducer * producers] {
+            uint64_t item;
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                if (queue.dequeue(item)) {
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    finish(queue, workers, producers);
+}
+
+// Same as pumpItems, but producers hand over and consumers take up to `batch` items per call
+template <typename QueueT>
+inline void pumpBatches(QueueT& queue, uint64_t producers, uint64_t consumers, uint64_t items,
+                        uint64_t batch) {
+    std::atomic<uint64_t> consumed{0};
+    std::vector<std::thread> workers;
+
+    uint64_t perProducer = items / producers;
+    for (uint64_t p = 0; p < producers; ++p) {
+        workers.emplace_back([&queue, perProducer, batch] {
+            std::vector<uint64_t> buf(batch);
+            for (uint64_t i = 0; i < perProducer; i += batch) {
+                uint64_t n = std::min(batch, perProducer - i);
+                std::iota(buf.begin(), buf.begin() + n, i);
+                queue.enqueueBulk(buf.begin(), buf.begin() + n);
+            }
+        });
+    }
+    for (uint64_t c = 0; c < consumers; ++c) {
+        workers.emplace_back([&queue, &consumed, batch, total = perProducer * producers] {
+            std::vector<uint64_t> buf(batch);
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                consumed.fetch_add(queue.dequeueBulk(buf.begin(), batch), std::memory_order_relaxed);
+            }
+        });
+    }
+    finish(queue, workers, producers);
+}
+
+}  // impl
+
+} // namespace
+
+// Items per second through a queue of uint64_t shared by the given producers and consumers
+template <typename QueueT>
+inline double queueThroughput(uint64_t producers, uint64_t consumers, uint64_t items) {
+    QueueT queue;
+    auto start = std::chrono::steady_clock::now();
+    impl::pumpItems(queue, producers, consumers, items);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    return static_cast<double>(items) * 1e9 / static_cast<double>(ns);
+}
+
+// Items per second when every call moves up to `batch` items
+template <typename QueueT>
+inline double queueBulkThroughput(uint64_t producers, uint64_t consumers, uint64_t items,
+                                  uint64_t batch) {
+    QueueT queue;
+    auto start = std::chrono::steady_clock::now();
+    impl::pumpBatches(queue, producers, consumers, items, batch);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    return static_cast<double>(items) * 1e9 / static_cast<double>(ns);
+}
+
+} // namespace bench
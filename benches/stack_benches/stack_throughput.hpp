@@ -0,0 +1,62 @@
+#pragma once
+
+#include <lib/stacks/lockfree_stack.hpp>
+
+namespace bench {
+
+// One vector behind one mutex, the baseline for concurrent stacks
+template <typename T>
+class LockedStack {
+private:
+    std::mutex mut_;
+    std::vector<T> items_;
+
+public:
+    void push(T&& item) {
+        std::lock_guard<std::mutex> guard{mut_};
+        items_.push_back(std::move(item));
+    }
+
+    bool pop(T& item) {
+        std::lock_guard<std::mutex> guard{mut_};
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.back());
+        items_.pop_back();
+        return true;
+    }
+};
+
+// Operations per second of threads that each take an object from a shared LIFO pool and put it
+// back, the hot path of an object pool. The pool starts with one object per thread.
+template <typename StackT>
+inline double stackThroughput(uint64_t threads, uint64_t pairs) {
+    StackT stack;
+    for (uint64_t i = 0; i < threads; ++i) {
+        stack.push(uint64_t{i});
+    }
+    uint64_t perThread = pairs / threads;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (uint64_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            uint64_t item = 0;
+            for (uint64_t i = 0; i < perThread; ++i) {
+                if (stack.pop(item)) {
+                    stack.push(std::move(item));
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    return static_cast<double>(2 * perThread * threads) * 1e9 / static_cast<double>(ns);
+}
+
+} // namespace bench
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <lib/stacks/work_stealing_deque.hpp>
+
+namespace bench {
+
+struct WorkStealingReport {
+    double itemsPerSec;
+    // share of the items that thieves took
+    double stolenShare;
+    // items taken never or more than once, must be 0
+    uint64_t errors;
+};
+
+// One owner pushes items in bursts and pops half of every burst back, the way a worker spawns
+// tasks and runs some of them itself; thieves take the rest with steal(), or with steal_half()
+// when stealHalf is set. Every item must be taken exactly once. capacity is the initial array
+// size, keep it small to make the owner grow the array while thieves read it.
+inline WorkStealingReport workStealing(uint64_t thieves, uint64_t items, bool stealHalf,
+                                       uint64_t capacity = 64, uint64_t burst = 256) {
+    WorkStealingDeque<uint64_t> deque(capacity);
+    std::vector<std::atomic<uint8_t>> hits(items);
+    std::atomic<uint64_t> stolen{0};
+    std::atomic<bool> done{false};
+
+    auto take = [&hits](uint64_t item) {
+        hits[item].fetch_add(1, std::memory_order_relaxed);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (uint64_t t = 0; t < thieves; ++t) {
+        workers.emplace_back([&] {
+            std::vector<uint64_t> loot;
+            uint64_t mine = 0;
+            uint64_t item = 0;
+            while (true) {
+                // read done before trying, so the last attempt sees everything the owner left
+                bool last = done.load(std::memory_order_acquire);
+                bool got = false;
+                if (stealHalf) {
+                    loot.clear();
+                    got = deque.steal_half(std::back_inserter(loot)) > 0;
+                    for (uint64_t stolenItem : loot) {
+                        take(stolenItem);
+                    }
+                    mine += loot.size();
+                } else if (deque.steal(item)) {
+                    got = true;
+                    take(item);
+                    ++mine;
+                }
+                if (!got) {
+                    if (last && deque.empty()) {
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            stolen.fetch_add(mine, std::memory_order_relaxed);
+        });
+    }
+
+    uint64_t item = 0;
+    for (uint64_t next = 0; next < items;) {
+        uint64_t end = std::min(items, next + burst);
+        for (; next < end; ++next) {
+            deque.push_bottom(next);
+        }
+        for (uint64_t i = 0; i < burst / 2 && deque.pop_bottom(item); ++i) {
+            take(item);
+        }
+    }
+    while (deque.pop_bottom(item)) {
+        take(item);
+    }
+    done.store(true, std::memory_order_release);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+    uint64_t errors = 0;
+    for (auto& hit : hits) {
+        errors += hit.load(std::memory_order_relaxed) != 1;
+    }
+    return {static_cast<double>(items) * 1e9 / static_cast<double>(ns),
+            static_cast<double>(stolen.load()) / static_cast<double>(items), errors};
+}
+
+} // namespace bench
@@ -2,9 +2,30 @@
 #include <benchmark/benchmark.h>
 
 #include <benches/queue_benches/quick_sort.hpp>
+#include <benches/map_benches/map_latency.hpp>
+#include <benches/queue_benches/queue_alloc.hpp>
+#include <benches/queue_benches/queue_latency.hpp>
+#include <benches/queue_benches/queue_overload.hpp>
+#include <benches/queue_benches/queue_syscalls.hpp>
+#include <benches/queue_benches/queue_priority.hpp>
+#include <benches/queue_benches/heap_ops.hpp>
+#include <benches/queue_benches/queue_reclaim.hpp>
+#include <benches/stack_benches/stack_throughput.hpp>
+#include <benches/stack_benches/work_stealing.hpp>
 
 int main(int argc, char* argv[]) 
 try {
+    // Any --benchmark_* flag (--benchmark_filter=Stack, --benchmark_list_tests, ...) runs the
+    // benchmarks registered below instead of the quick sort demo
+    if (std::any_of(argv + 1, argv + argc, [](std::string_view arg) {
+            return arg.starts_with("--benchmark");
+        })) {
+        benchmark::Initialize(&argc, argv);
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+        return EXIT_SUCCESS;
+    }
+
     // argparse::ArgumentParser parser("ts_conainers");
     // parser.add_argument("cores").default_value(1).scan<'i', uint64_t>();
     // parser.add_argument("size").default_value(1).scan<'i', uint64_t>();
@@ -65,5 +86,321 @@ BENCHMARK_CAPTURE(QuickSortBenchmark, 14, 100'000, 14)->Iterations(1);
 BENCHMARK_CAPTURE(QuickSortBenchmark, 15, 100'000, 15)->Iterations(1);
 BENCHMARK_CAPTURE(QuickSortBenchmark, 16, 100'000, 16)->Iterations(1);
 
-// Run the benchmark
-//BENCHMARK_MAIN();
+static void MapInsertLatencyBenchmark(benchmark::State& state, uint64_t keys, uint64_t threads) {
+    bench::LatencyReport report{};
+    while (state.KeepRunning()) {
+        report = bench::insertLatency(threads, keys);
+    }
+    state.counters["p50_ns"] = static_cast<double>(report.p50);
+    state.counters["p99_ns"] = static_cast<double>(report.p99);
+    state.counters["p999_ns"] = static_cast<double>(report.p999);
+    state.counters["max_ns"] = static_cast<double>(report.max);
+}
+
+BENCHMARK_CAPTURE(MapInsertLatencyBenchmark, 1, 4'000'000, 1)->Iterations(1);
+BENCHMARK_CAPTURE(MapInsertLatencyBenchmark, 4, 4'000'000, 4)->Iterations(1);
+BENCHMARK_CAPTURE(MapInsertLatencyBenchmark, 8, 4'000'000, 8)->Iterations(1);
+
+// Heap allocations per item of the MS queue, with pooled nodes and with one new/delete per node
+template <template <size_t, size_t> class NodeAlloc>
+static void MSQueueAllocBenchmark(benchmark::State& state, uint64_t items, uint64_t threads) {
+    using Queue = uniQueue<uint64_t, uniQSpec(Base::List, Bounded::No, Contention::Lockfree,
+                                              Priority::No), reclaim::HazardPointers, NodeAlloc>;
+    bench::AllocReport report{};
+    while (state.KeepRunning()) {
+        report = bench::queueAllocations<Queue>(threads, threads, items);
+    }
+    state.counters["allocs_per_item"] = report.allocsPerItem;
+    state.counters["ns_per_item"] = report.nsPerItem;
+}
+
+BENCHMARK_CAPTURE(MSQueueAllocBenchmark<slab::Pool>, pooled_1, 1'000'000, 1)->Iterations(1);
+BENCHMARK_CAPTURE(MSQueueAllocBenchmark<slab::Pool>, pooled_2, 1'000'000, 2)->Iterations(1);
+BENCHMARK_CAPTURE(MSQueueAllocBenchmark<slab::Heap>, heap_1, 1'000'000, 1)->Iterations(1);
+BENCHMARK_CAPTURE(MSQueueAllocBenchmark<slab::Heap>, heap_2, 1'000'000, 2)->Iterations(1);
+
+using MSQueue = uniQueue<uint64_t, uniQSpec(Base::List, Bounded::No, Contention::Lockfree,
+                                            Priority::No)>;
+using SegmentedQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::No,
+                                                   Contention::Lockfree, Priority::No)>;
+using WaitfreeQueue = uniQueue<uint64_t, uniQSpec(Base::List, Bounded::No, Contention::Waitfree,
+                                                  Priority::No)>;
+
+// Half of the threads produce, half consume
+template <typename QueueT>
+static void QueueThroughputBenchmark(benchmark::State& state, uint64_t items, uint64_t threads) {
+    double itemsPerSec = 0;
+    while (state.KeepRunning()) {
+        itemsPerSec = bench::queueThroughput<QueueT>(threads / 2, threads / 2, items);
+    }
+    state.counters["items_per_sec"] = itemsPerSec;
+}
+
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<MSQueue>, ms_4, 4'000'000, 4)->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<MSQueue>, ms_16, 4'000'000, 16)->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<MSQueue>, ms_32, 4'000'000, 32)->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<SegmentedQueue>, segmented_4, 4'000'000, 4)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<SegmentedQueue>, segmented_16, 4'000'000, 16)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<SegmentedQueue>, segmented_32, 4'000'000, 32)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<WaitfreeQueue>, waitfree_4, 4'000'000, 4)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<WaitfreeQueue>, waitfree_16, 4'000'000, 16)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<WaitfreeQueue>, waitfree_32, 4'000'000, 32)
+        ->Iterations(1);
+
+using BoundedQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::Yes, Contention::Lockfree,
+                                                 Priority::No)>;
+using BlockingQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::No, Contention::Blocking,
+                                                  Priority::No)>;
+
+// Half of the threads produce, half consume, every call moves up to `batch` items
+template <typename QueueT>
+static void QueueBulkBenchmark(benchmark::State& state, uint64_t items, uint64_t threads,
+                               uint64_t batch) {
+    double itemsPerSec = 0;
+    while (state.KeepRunning()) {
+        itemsPerSec = bench::queueBulkThroughput<QueueT>(threads / 2, threads / 2, items, batch);
+    }
+    state.counters["items_per_sec"] = itemsPerSec;
+}
+
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<BoundedQueue>, bounded_8, 4'000'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueBulkBenchmark<BoundedQueue>, bounded_8_b64, 4'000'000, 8, 64)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<BlockingQueue>, blocking_8, 4'000'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueBulkBenchmark<BlockingQueue>, blocking_8_b128, 4'000'000, 8, 128)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueBulkBenchmark<SegmentedQueue>, segmented_8_b128, 4'000'000, 8, 128)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueBulkBenchmark<MSQueue>, ms_8_b128, 4'000'000, 8, 128)->Iterations(1);
+
+// Per-call latency tail, half of the threads produce, half consume
+template <typename QueueT>
+static void QueueLatencyBenchmark(benchmark::State& state, uint64_t items, uint64_t threads) {
+    bench::LatencyReport report{};
+    while (state.KeepRunning()) {
+        report = bench::queueLatency<QueueT>(threads / 2, threads / 2, items);
+    }
+    state.counters["p50_ns"] = static_cast<double>(report.p50);
+    state.counters["p99_ns"] = static_cast<double>(report.p99);
+    state.counters["p999_ns"] = static_cast<double>(report.p999);
+    state.counters["max_ns"] = static_cast<double>(report.max);
+}
+
+BENCHMARK_CAPTURE(QueueLatencyBenchmark<MSQueue>, ms_16, 2'000'000, 16)->Iterations(1);
+BENCHMARK_CAPTURE(QueueLatencyBenchmark<WaitfreeQueue>, waitfree_16, 2'000'000, 16)
+        ->Iterations(1);
+
+using SpscQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::Yes, Contention::Lockfree,
+                                              Priority::No, Producers::Single,
+                                              Consumers::Single)>;
+using SpmcQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::Yes, Contention::Lockfree,
+                                              Priority::No, Producers::Single)>;
+using MpscQueue = uniQueue<uint64_t, uniQSpec(Base::List, Bounded::No, Contention::Lockfree,
+                                              Priority::No, Consumers::Single)>;
+
+// Fixed numbers of producers and consumers, for queues restricted to a single one of either
+template <typename QueueT>
+static void QueueRolesBenchmark(benchmark::State& state, uint64_t items, uint64_t producers,
+                                uint64_t consumers) {
+    double itemsPerSec = 0;
+    while (state.KeepRunning()) {
+        itemsPerSec = bench::queueThroughput<QueueT>(producers, consumers, items);
+    }
+    state.counters["items_per_sec"] = itemsPerSec;
+}
+
+BENCHMARK_CAPTURE(QueueRolesBenchmark<SpscQueue>, spsc_1_1, 4'000'000, 1, 1)->Iterations(1);
+BENCHMARK_CAPTURE(QueueRolesBenchmark<BoundedQueue>, bounded_1_1, 4'000'000, 1, 1)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueRolesBenchmark<SpmcQueue>, spmc_1_4, 4'000'000, 1, 4)->Iterations(1);
+BENCHMARK_CAPTURE(QueueRolesBenchmark<BoundedQueue>, bounded_1_4, 4'000'000, 1, 4)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueRolesBenchmark<MpscQueue>, mpsc_4_1, 4'000'000, 4, 1)->Iterations(1);
+BENCHMARK_CAPTURE(QueueRolesBenchmark<MSQueue>, ms_4_1, 4'000'000, 4, 1)->Iterations(1);
+
+using PaddedBoundedQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::Yes,
+                                                       Contention::Lockfree, Priority::No,
+                                                       Layout::PaddedCells)>;
+using ScrambledBoundedQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::Yes,
+                                                          Contention::Lockfree, Priority::No,
+                                                          Layout::Scrambled)>;
+
+// False sharing between neighbouring cells of the bounded ring, packed vs padded vs scrambled
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<BoundedQueue>, packed_2, 4'000'000, 2)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<PaddedBoundedQueue>, padded_2, 4'000'000, 2)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<ScrambledBoundedQueue>, scrambled_2, 4'000'000, 2)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<BoundedQueue>, packed_8, 4'000'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<PaddedBoundedQueue>, padded_8, 4'000'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<ScrambledBoundedQueue>, scrambled_8, 4'000'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<BoundedQueue>, packed_32, 4'000'000, 32)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<PaddedBoundedQueue>, padded_32, 4'000'000, 32)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueThroughputBenchmark<ScrambledBoundedQueue>, scrambled_32, 4'000'000, 32)
+        ->Iterations(1);
+
+using SpinBoundedQueue = mpmc_bounded_queue<uint64_t, RingLayout::Packed, backoff::Spin>;
+using YieldBoundedQueue = mpmc_bounded_queue<uint64_t, RingLayout::Packed, backoff::Yield>;
+using ParkBoundedQueue = mpmc_bounded_queue<uint64_t, RingLayout::Packed, backoff::Park>;
+
+// Cores burnt by producers waiting on a full ring, per backoff policy
+template <typename QueueT>
+static void QueueOverloadBenchmark(benchmark::State& state, uint64_t items, uint64_t producers) {
+    bench::OverloadReport report{};
+    while (state.KeepRunning()) {
+        report = bench::queueOverload<QueueT>(producers, items, 2us);
+    }
+    state.counters["items_per_sec"] = report.itemsPerSec;
+    state.counters["busy_cores"] = report.busyCores;
+}
+
+BENCHMARK_CAPTURE(QueueOverloadBenchmark<SpinBoundedQueue>, spin_8, 200'000, 8)->Iterations(1);
+BENCHMARK_CAPTURE(QueueOverloadBenchmark<YieldBoundedQueue>, yield_8, 200'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueOverloadBenchmark<ParkBoundedQueue>, park_8, 200'000, 8)->Iterations(1);
+
+using BlockingBoundedQ = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::Yes,
+                                                     Contention::Blocking, Priority::No)>;
+
+// Kernel entries per million items, futex-parking bounded queue vs the mutex-based unbounded one
+template <typename QueueT>
+static void QueueSyscallBenchmark(benchmark::State& state, uint64_t items, uint64_t threads) {
+    bench::SyscallReport report{};
+    while (state.KeepRunning()) {
+        report = bench::queueSyscalls<QueueT>(threads / 2, threads / 2, items);
+    }
+    state.counters["items_per_sec"] = report.itemsPerSec;
+    state.counters["futex_per_mop"] = report.futexPerMop;
+    state.counters["ctx_switches_per_mop"] = report.switchesPerMop;
+}
+
+BENCHMARK_CAPTURE(QueueSyscallBenchmark<BlockingBoundedQ>, blocking_bounded_8, 4'000'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueSyscallBenchmark<BlockingQueue>, blocking_unbounded_8, 4'000'000, 8)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueSyscallBenchmark<BoundedQueue>, lockfree_bounded_8, 4'000'000, 8)
+        ->Iterations(1);
+
+using MultiQueue = uniQueue<uint64_t, uniQSpec(Base::Array, Bounded::No, Priority::Yes,
+                                               Contention::Blocking)>;
+using LockedHeap = bench::LockedHeap<uint64_t>;
+
+// Relaxed MultiQueue vs one locked heap, with the rank error the relaxation costs
+template <typename QueueT>
+static void PriorityQueueBenchmark(benchmark::State& state, uint64_t items, uint64_t threads) {
+    double itemsPerSec = 0;
+    while (state.KeepRunning()) {
+        itemsPerSec = bench::queueThroughput<QueueT>(threads / 2, threads / 2, items);
+    }
+    state.counters["items_per_sec"] = itemsPerSec;
+    state.counters["rank_error"] = bench::queueRankError<QueueT>(1'000'000, 10'000);
+}
+
+BENCHMARK_CAPTURE(PriorityQueueBenchmark<MultiQueue>, multiqueue_4, 4'000'000, 4)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(PriorityQueueBenchmark<LockedHeap>, locked_heap_4, 4'000'000, 4)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(PriorityQueueBenchmark<MultiQueue>, multiqueue_32, 4'000'000, 32)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(PriorityQueueBenchmark<LockedHeap>, locked_heap_32, 4'000'000, 32)
+        ->Iterations(1);
+
+using BinaryHeap = BinHeap<uint64_t>;
+using QuadHeap = DaryHeap<uint64_t, 4>;
+using OctHeap = DaryHeap<uint64_t, 8>;
+using MinMaxHeap64 = MinMaxHeap<uint64_t>;
+
+// Pop + push at a steady heap size, from L1-resident to far beyond the last-level cache
+template <typename HeapT>
+static void HeapHoldBenchmark(benchmark::State& state) {
+    double ns = 0;
+    while (state.KeepRunning()) {
+        ns = bench::heapHoldNs<HeapT>(static_cast<uint64_t>(state.range(0)), 1'000'000);
+    }
+    state.counters["ns_per_op"] = ns;
+}
+
+BENCHMARK_TEMPLATE(HeapHoldBenchmark, BinaryHeap)->RangeMultiplier(10)->Range(1'000, 10'000'000)
+        ->Iterations(1);
+BENCHMARK_TEMPLATE(HeapHoldBenchmark, QuadHeap)->RangeMultiplier(10)->Range(1'000, 10'000'000)
+        ->Iterations(1);
+BENCHMARK_TEMPLATE(HeapHoldBenchmark, OctHeap)->RangeMultiplier(10)->Range(1'000, 10'000'000)
+        ->Iterations(1);
+BENCHMARK_TEMPLATE(HeapHoldBenchmark, MinMaxHeap64)->RangeMultiplier(10)->Range(1'000, 10'000'000)
+        ->Iterations(1);
+
+template <typename Reclaim>
+using MsQueue = uniQueue<uint64_t, uniQSpec(Base::List, Bounded::No, Contention::Lockfree,
+                                            Priority::No), Reclaim>;
+
+// Per-operation cost of the MS queue and the garbage it holds under each reclamation policy
+template <typename Reclaim>
+static void QueueReclaimBenchmark(benchmark::State& state, uint64_t pairs, uint64_t threads) {
+    bench::ReclaimReport report{};
+    while (state.KeepRunning()) {
+        report = bench::queueReclaim<MsQueue<Reclaim>, Reclaim>(threads, pairs, 64);
+    }
+    state.counters["ns_per_op"] = report.nsPerOp;
+    state.counters["peak_pending"] = static_cast<double>(report.peakPending);
+    state.counters["mean_pending"] = report.meanPending;
+}
+
+BENCHMARK_CAPTURE(QueueReclaimBenchmark<reclaim::HazardPointers>, hazard_4, 4'000'000, 4)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueReclaimBenchmark<reclaim::EpochBased>, epoch_4, 4'000'000, 4)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(QueueReclaimBenchmark<reclaim::QuiescentState>, qsbr_4, 4'000'000, 4)
+        ->Iterations(1);
+
+using EliminationStack = lfStack<uint64_t>;
+using TreiberStack = lfStack<uint64_t, reclaim::HazardPointers, 0>;
+using LockedStack = bench::LockedStack<uint64_t>;
+
+// Object pool hot path: pop + push on a shared LIFO, with and without elimination backoff
+template <typename StackT>
+static void StackThroughputBenchmark(benchmark::State& state, uint64_t pairs, uint64_t threads) {
+    double opsPerSec = 0;
+    while (state.KeepRunning()) {
+        opsPerSec = bench::stackThroughput<StackT>(threads, pairs);
+    }
+    state.counters["ops_per_sec"] = opsPerSec;
+}
+
+BENCHMARK_CAPTURE(StackThroughputBenchmark<EliminationStack>, elimination_16, 8'000'000, 16)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(StackThroughputBenchmark<TreiberStack>, treiber_16, 8'000'000, 16)
+        ->Iterations(1);
+BENCHMARK_CAPTURE(StackThroughputBenchmark<LockedStack>, locked_16, 8'000'000, 16)
+        ->Iterations(1);
+
+// One owner spawning bursts of tasks, thieves taking one item or half the deque per attempt
+static void WorkStealingBenchmark(benchmark::State& state, uint64_t items, uint64_t thieves,
+                                  bool stealHalf) {
+    bench::WorkStealingReport report{};
+    while (state.KeepRunning()) {
+        report = bench::workStealing(thieves, items, stealHalf);
+        if (report.errors != 0) {
+            state.SkipWithError("items lost or taken twice");
+            break;
+        }
+    }
+    state.counters["items_per_sec"] = report.itemsPerSec;
+    state.counters["stolen_share"] = report.stolenShare;
+}
+
+BENCHMARK_CAPTURE(WorkStealingBenchmark, steal_one_8, 8'000'000, 8, false)->Iterations(1);
+BENCHMARK_CAPTURE(WorkStealingBenchmark, steal_half_8, 8'000'000, 8, true)->Iterations(1);
+
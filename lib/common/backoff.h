@@ -0,0 +1,79 @@
+#pragma once
+
+#include <lib/common/common.h>
+
+// Backoff policies for threads waiting on a condition another thread will establish.
+//
+// A policy is a small per-wait object. The waiter calls Pause() after every failed attempt;
+// Pause() burns or yields some time and returns true, or returns false once the policy wants
+// the waiter to stop retrying and sleep in the kernel until it is woken. Policies that never
+// return false keep the waiter on the CPU for as long as the wait lasts; they say so with
+// PARKS = false, which lets the waking side skip looking for sleepers altogether.
+
+namespace backoff {
+
+// One hint to the core that we are in a spin loop
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+// Exponentially growing busy-wait, never leaves the CPU. Lowest latency, burns a core.
+class Spin {
+private:
+    static constexpr uint32_t MAX_PAUSES = 1024;
+    uint32_t pauses_ = 1;
+
+public:
+    static constexpr bool PARKS = false;
+
+    bool Pause() {
+        for (uint32_t i = 0; i < pauses_; ++i) {
+            CpuRelax();
+        }
+        pauses_ = std::min(pauses_ * 2, MAX_PAUSES);
+        return true;
+    }
+};
+
+// Hands the CPU to another runnable thread on every round, never parks.
+class Yield {
+public:
+    static constexpr bool PARKS = false;
+
+    bool Pause() {
+        std::this_thread::yield();
+        return true;
+    }
+};
+
+// A few rounds of exponential spinning, then a few yields, then asks to be parked. Short
+// waits stay cheap while a long one costs no CPU at all.
+class Park {
+private:
+    static constexpr uint32_t SPIN_ROUNDS = 7;
+    static constexpr uint32_t YIELD_ROUNDS = 4;
+    uint32_t round_ = 0;
+
+public:
+    static constexpr bool PARKS = true;
+
+    bool Pause() {
+        if (round_ < SPIN_ROUNDS) {
+            for (uint32_t i = 0; i < (1u << round_); ++i) {
+                CpuRelax();
+            }
+        } else if (round_ < SPIN_ROUNDS + YIELD_ROUNDS) {
+            std::this_thread::yield();
+        } else {
+            return false;
+        }
+        ++round_;
+        return true;
+    }
+};
+
+} // namespace backoff
@@ -25,11 +25,62 @@
 #include <array>
 #include <list>
 #include <algorithm>
+#include <numeric>
+#include <new>
+#include <bit>
+#include <iterator>
 
 using namespace std::chrono_literals;
 
 static std::mutex mtx;
 
+// Assumed size of a cache line on every platform we build for.
+constexpr std::size_t CACHE_LINE = 64;
+
+// Allocator handing out storage that starts on a cache line boundary.
+template <typename T>
+struct cache_aligned_allocator {
+    using value_type = T;
+
+    cache_aligned_allocator() = default;
+
+    template <typename U>
+    cache_aligned_allocator(const cache_aligned_allocator<U>&) noexcept {
+    }
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{CACHE_LINE}));
+    }
+
+    void deallocate(T* ptr, std::size_t) noexcept {
+        ::operator delete(ptr, std::align_val_t{CACHE_LINE});
+    }
+
+    template <typename U>
+    bool operator==(const cache_aligned_allocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+// Asks the CPU to pull the line holding ptr into cache, a no-op where unsupported
+inline void prefetch(const void* ptr) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(ptr);
+#else
+    (void)ptr;
+#endif
+}
+
+// Per-thread xorshift64 generator: cheap and good enough to pick a random slot or shard,
+// not for anything statistical
+inline uint64_t fastRandom() {
+    thread_local uint64_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
 template <typename T>
 std::ostream& operator<<(std::ostream& out, const std::vector<T>& vec) {
     for (size_t i = 0; i < vec.size(); i++) {
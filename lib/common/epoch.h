@@ -0,0 +1,239 @@
+#pragma once
+
+#include <lib/common/fence.h>
+
+// Epoch based reclamation (EBR).
+//
+// Readers wrap every access to shared nodes in an ebr::Guard, which only publishes the global
+// epoch in a thread-private record - no CAS, no lock, so the read side stays wait-free.
+// Writers unlink a node first and then hand it to Retire(). A retired node is freed once the
+// global epoch has moved two steps past the epoch it was retired in: by then every reader that
+// could still hold a reference has left its critical section.
+
+namespace ebr {
+
+namespace {
+
+constexpr uint64_t ACTIVE = 1;
+constexpr uint64_t COLLECT_THRESHOLD = 64;
+
+} // namespace
+
+struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;
+};
+
+struct alignas(CACHE_LINE) ThreadRecord {
+    // (epoch << 1) | ACTIVE while the owner is inside a critical section, 0 otherwise
+    std::atomic<uint64_t> state{0};
+    std::atomic<bool> inUse{true};
+    // size of retired, for statistics
+    std::atomic<uint64_t> pending{0};
+    ThreadRecord* next = nullptr;
+
+    // owner-only part
+    uint64_t nesting = 0;
+    std::vector<Retired> retired;
+    // retired[untagged..] still wait for their epoch, see TagRetired
+    uint64_t untagged = 0;
+    // grows with the survivors of the last collection, so a stalled epoch costs O(1) per retire
+    uint64_t collectAt = COLLECT_THRESHOLD;
+};
+
+class EpochDomain {
+private:
+    std::atomic<uint64_t> globalEpoch_{2};
+    std::atomic<ThreadRecord*> records_{nullptr};
+
+    // nodes left behind by exited threads, reclaimed by whoever collects next
+    std::mutex orphansMut_;
+    std::vector<Retired> orphans_;
+    std::atomic<uint64_t> orphanCount_{0};
+
+    static void FreeSafe(std::vector<Retired>& list, uint64_t epoch) {
+        auto alive = std::partition(list.begin(), list.end(), [epoch](const Retired& r) {
+            return r.epoch + 2 > epoch;
+        });
+        for (auto it = alive; it != list.end(); ++it) {
+            it->deleter(it->ptr);
+        }
+        list.erase(alive, list.end());
+    }
+
+public:
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    ~EpochDomain() {
+        // called at exit, no reader can be active anymore
+        ThreadRecord* rec = records_.load(std::memory_order_acquire);
+        while (rec != nullptr) {
+            ThreadRecord* next = rec->next;
+            for (auto& r : rec->retired) {
+                r.deleter(r.ptr);
+            }
+            delete rec;
+            rec = next;
+        }
+        for (auto& r : orphans_) {
+            r.deleter(r.ptr);
+        }
+    }
+
+    ThreadRecord* AcquireRecord() {
+        // records of exited threads are reused, so the list only grows with peak thread count
+        for (ThreadRecord* rec = records_.load(std::memory_order_acquire); rec != nullptr;
+             rec = rec->next) {
+            bool expected = false;
+            if (!rec->inUse.load(std::memory_order_relaxed) &&
+                rec->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return rec;
+            }
+        }
+
+        ThreadRecord* rec = new ThreadRecord;
+        ThreadRecord* head = records_.load(std::memory_order_relaxed);
+        do {
+            rec->next = head;
+        } while (!records_.compare_exchange_weak(head, rec, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        return rec;
+    }
+
+    // Stamps the nodes retired since the last call with the current epoch. A single fence
+    // orders all their unlinks before the epoch is read; stamping later than the unlink only
+    // delays the free, and the retire path stays free of fences.
+    void TagRetired(ThreadRecord* rec) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t epoch = globalEpoch_.load(std::memory_order_relaxed);
+        for (uint64_t i = rec->untagged; i < rec->retired.size(); ++i) {
+            rec->retired[i].epoch = epoch;
+        }
+        rec->untagged = rec->retired.size();
+    }
+
+    void ReleaseRecord(ThreadRecord* rec) {
+        if (!rec->retired.empty()) {
+            TagRetired(rec);
+            std::lock_guard<std::mutex> guard(orphansMut_);
+            orphans_.insert(orphans_.end(), rec->retired.begin(), rec->retired.end());
+            orphanCount_.store(orphans_.size(), std::memory_order_relaxed);
+            rec->retired.clear();
+            rec->untagged = 0;
+            rec->pending.store(0, std::memory_order_relaxed);
+        }
+        rec->state.store(0, std::memory_order_release);
+        rec->inUse.store(false, std::memory_order_release);
+    }
+
+    void Enter(ThreadRecord* rec) {
+        if (rec->nesting++ == 0) {
+            uint64_t epoch = globalEpoch_.load(std::memory_order_relaxed);
+            rec->state.store((epoch << 1) | ACTIVE, std::memory_order_relaxed);
+            // the announcement must be visible before any shared pointer is read
+            fence::Light();
+        }
+    }
+
+    void Leave(ThreadRecord* rec) {
+        if (--rec->nesting == 0) {
+            rec->state.store(0, std::memory_order_release);
+        }
+    }
+
+    // The epoch can only move on when every active thread has observed the current one
+    bool TryAdvance() {
+        fence::Heavy();
+        uint64_t epoch = globalEpoch_.load(std::memory_order_acquire);
+        for (ThreadRecord* rec = records_.load(std::memory_order_acquire); rec != nullptr;
+             rec = rec->next) {
+            uint64_t state = rec->state.load(std::memory_order_acquire);
+            if ((state & ACTIVE) && (state >> 1) != epoch) {
+                return false;
+            }
+        }
+        return globalEpoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+    }
+
+    void Retire(ThreadRecord* rec, void* ptr, void (*deleter)(void*)) {
+        rec->retired.push_back({ptr, deleter, 0});
+        if (rec->retired.size() >= rec->collectAt) {
+            Collect(rec);
+            rec->collectAt = std::max<uint64_t>(COLLECT_THRESHOLD, 2 * rec->retired.size());
+        }
+        rec->pending.store(rec->retired.size(), std::memory_order_relaxed);
+    }
+
+    void Collect(ThreadRecord* rec) {
+        TagRetired(rec);
+        TryAdvance();
+        uint64_t epoch = globalEpoch_.load(std::memory_order_acquire);
+        FreeSafe(rec->retired, epoch);
+        rec->untagged = rec->retired.size();
+
+        std::unique_lock<std::mutex> guard(orphansMut_, std::try_to_lock);
+        if (guard.owns_lock()) {
+            FreeSafe(orphans_, epoch);
+            orphanCount_.store(orphans_.size(), std::memory_order_relaxed);
+        }
+    }
+
+    // Nodes retired but not freed yet, a racy snapshot
+    uint64_t Pending() const {
+        uint64_t pending = orphanCount_.load(std::memory_order_relaxed);
+        for (ThreadRecord* rec = records_.load(std::memory_order_acquire); rec != nullptr;
+             rec = rec->next) {
+            pending += rec->pending.load(std::memory_order_relaxed);
+        }
+        return pending;
+    }
+};
+
+inline EpochDomain globalDomain;
+
+struct ThreadHandle {
+    ThreadRecord* rec = globalDomain.AcquireRecord();
+
+    ~ThreadHandle() {
+        globalDomain.ReleaseRecord(rec);
+    }
+};
+
+inline ThreadRecord* LocalRecord() {
+    thread_local ThreadHandle handle;
+    return handle.rec;
+}
+
+// RAII read-side critical section, may be nested
+class Guard {
+private:
+    ThreadRecord* rec_;
+
+public:
+    Guard(): rec_(LocalRecord()) {
+        globalDomain.Enter(rec_);
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    ~Guard() {
+        globalDomain.Leave(rec_);
+    }
+};
+
+template <typename T>
+void Retire(T* ptr) {
+    globalDomain.Retire(LocalRecord(), ptr, [](void* p) {
+        delete static_cast<T*>(p);
+    });
+}
+
+inline void Retire(void* ptr, void (*deleter)(void*)) {
+    globalDomain.Retire(LocalRecord(), ptr, deleter);
+}
+
+} // namespace ebr
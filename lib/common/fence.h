@@ -0,0 +1,56 @@
+#pragma once
+
+#include <lib/common/common.h>
+
+#ifdef __linux__
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Asymmetric store-load fences.
+//
+// Reclamation schemes make a reader publish something (a hazard pointer, an epoch) and then
+// read shared memory, while a rare reclaiming thread reads what readers published. Both sides
+// need a full barrier between their store and their load. Light() is the reader's half, Heavy()
+// the reclaimer's: where the kernel has membarrier(2), Light() only keeps the compiler from
+// reordering and Heavy() makes every running thread of the process execute the barrier. Off
+// Linux, or when membarrier is not available, both are plain seq_cst fences.
+
+namespace fence {
+
+namespace {
+
+#ifdef __linux__
+bool RegisterMembarrier() {
+    return syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+}
+#else
+bool RegisterMembarrier() {
+    return false;
+}
+#endif
+
+} // namespace
+
+inline const bool asymmetric = RegisterMembarrier();
+
+inline void Light() {
+    if (asymmetric) {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+inline void Heavy() {
+#ifdef __linux__
+    if (asymmetric) {
+        syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+        return;
+    }
+#endif
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+} // namespace fence
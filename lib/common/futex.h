@@ -0,0 +1,139 @@
+#pragma once
+
+#include <lib/common/common.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#endif
+
+// Sleeping on a 32-bit word.
+//
+// Wait() puts the caller to sleep in the kernel as long as the word still holds the value the
+// caller last saw; Wake() wakes sleepers after the word was changed. The check and the sleep
+// are atomic with respect to Wake(), so a change made between the caller's read and its Wait()
+// is never lost. Unlike std::atomic::wait a sleep can be bounded by a timeout. Wakeups may be
+// spurious: callers re-check their condition in a loop. Off Linux the calls fall back to
+// std::atomic::wait / notify, with timed waits polling.
+
+namespace futex {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+              std::atomic<uint32_t>::is_always_lock_free);
+
+constexpr std::chrono::nanoseconds FOREVER = std::chrono::nanoseconds::max();
+
+// Wait and wake calls that went to the kernel, for benchmarks. A relaxed increment is noise
+// next to the syscall it counts.
+inline std::atomic<uint64_t> syscalls{0};
+
+// Returns false if the timeout expired before a wakeup
+inline bool Wait(std::atomic<uint32_t>& word, uint32_t expected,
+                 std::chrono::nanoseconds timeout = FOREVER) {
+#ifdef __linux__
+    timespec ts{};
+    timespec* tsp = nullptr;
+    if (timeout != FOREVER) {
+        if (timeout <= std::chrono::nanoseconds::zero()) {
+            return false;
+        }
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1'000'000'000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1'000'000'000);
+        tsp = &ts;
+    }
+    syscalls.fetch_add(1, std::memory_order_relaxed);
+    long res = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+                       expected, tsp, nullptr, 0);
+    return res == 0 || errno != ETIMEDOUT;
+#else
+    if (timeout == FOREVER) {
+        word.wait(expected, std::memory_order_acquire);
+        return true;
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (word.load(std::memory_order_acquire) == expected) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    return true;
+#endif
+}
+
+inline void WakeOne(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscalls.fetch_add(1, std::memory_order_relaxed);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr,
+            nullptr, 0);
+#else
+    word.notify_one();
+#endif
+}
+
+inline void WakeAll(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscalls.fetch_add(1, std::memory_order_relaxed);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+            nullptr, 0);
+#else
+    word.notify_all();
+#endif
+}
+
+// A futex word together with the number of threads sleeping on it, for a condition one side
+// waits for and the other side makes true. Park() counts the caller, fences and only then reads
+// the ticket and re-checks the condition; Wake() fences after the change that ends the wait and
+// only then reads the count. Either the waker sees the sleeper or the sleeper sees the change,
+// and a sleeper that reads a bumped ticket also sees everything the waker did before the bump.
+// While nobody sleeps a wake costs one fence and no syscall.
+class WaitQueue {
+private:
+    std::atomic<uint32_t> word_{0};
+    std::atomic<uint32_t> waiters_{0};
+
+    void Bump(uint64_t sleepers) {
+        word_.fetch_add(1, std::memory_order_release);
+        if (sleepers == 1) {
+            futex::WakeOne(word_);
+        } else {
+            futex::WakeAll(word_);
+        }
+    }
+
+public:
+    // Sleeps unless blocked() turns false in between, false if the timeout expired
+    template <typename Pred>
+    bool Park(Pred blocked, std::chrono::nanoseconds timeout = FOREVER) {
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t ticket = word_.load(std::memory_order_acquire);
+        bool woken = true;
+        if (blocked()) {
+            woken = futex::Wait(word_, ticket, timeout);
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return woken;
+    }
+
+    // Call after `count` waiters' worth of the condition became true, e.g. cells freed. Wakes
+    // one sleeper for a single one, all of them otherwise - a single call either way.
+    void Wake(uint64_t count) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (count == 0 || waiters_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        Bump(count);
+    }
+
+    // Wakes every sleeper without looking at the count, for rare events like a shutdown
+    void WakeAll() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Bump(std::numeric_limits<uint64_t>::max());
+    }
+};
+
+} // namespace futex
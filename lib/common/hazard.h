@@ -1,87 +1,238 @@
 #pragma once
 
-#include <lib/common/common.h>
+#include <lib/common/fence.h>
+
+// Hazard pointers (HP).
+//
+// Before dereferencing a shared node a reader publishes its address in one of the hazard slots
+// of its thread record and re-checks that the node is still reachable. Writers unlink a node
+// and retire it together with a deleter - a typed delete, or a function that hands the node
+// back to its pool; a retired node is freed only once a scan finds it in no hazard slot.
+// Thread records live in a lock-free list: a thread takes a free record on first use and
+// gives it back at exit, so the list only grows with the peak number of threads and any number
+// of threads may come and go. Nodes an exiting thread could not free yet are handed to the
+// domain and freed by the next thread that scans.
+//
+// A thread scans once it holds twice as many retired nodes as there are hazard slots, so every
+// scan frees at least half of them and the scan cost is spread over as many retires as there
+// are hazard slots. Publishing a hazard needs a store-load fence; readers take the light half
+// of an asymmetric fence (fence.h) and the scanning thread pays for the heavy one, once per scan.
 
 namespace hp {
 
-constexpr uint64_t THREADS_COUNT = 16;
-
 namespace {
 
 constexpr uint64_t HPTRS_PER_THREAD = 2;
-constexpr uint64_t TOTAL_HPTRS_COUNT = HPTRS_PER_THREAD * THREADS_COUNT;
-constexpr uint64_t RETIRED_COUNT = HPTRS_PER_THREAD * THREADS_COUNT * 2;
-
-std::mutex mut;
-uint64_t id = 0;
+// scan threshold while there are only a few hazard slots
+constexpr uint64_t MIN_RETIRED = 64;
 
 } // namespace
 
-struct ThreadLocalHazardManager {
-    std::array<ThreadLocalHazardManager*, 
-        THREADS_COUNT>& globalManagerRef;
-
-    ThreadLocalHazardManager(std::array<ThreadLocalHazardManager*, 
-                             THREADS_COUNT>& globalManager)
-            : globalManagerRef(globalManager) {
-        std::lock_guard<std::mutex> guard(mut);
-        globalManagerRef[id++]= this;
+// One hazard pointer. Assigning publishes it, ordered before the loads that validate it.
+class HazardSlot {
+private:
+    std::atomic<void*> ptr_{nullptr};
+
+public:
+    HazardSlot& operator=(void* ptr) {
+        ptr_.store(ptr, std::memory_order_release);
+        fence::Light();
+        return *this;
+    }
+
+    void* Get() const {
+        return ptr_.load(std::memory_order_acquire);
     }
+};
 
-    uint64_t rCount{};
+// deleter runs once no hazard pointer protects ptr anymore
+struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+};
 
-    std::array<void*, HPTRS_PER_THREAD> hptrs;
+struct alignas(CACHE_LINE) HazardRecord {
+    std::array<HazardSlot, HPTRS_PER_THREAD> hptrs{};
+    std::atomic<bool> inUse{true};
+    // size of retired, for statistics
+    std::atomic<uint64_t> pending{0};
+    HazardRecord* next = nullptr;
 
-    std::array<void*, RETIRED_COUNT> retired;
+    // owner-only part
+    std::vector<Retired> retired;
+    std::vector<void*> hazards;
+};
 
-    void RetireNode(void* node) {
-        retired[rCount++] = node;
-        if (rCount == RETIRED_COUNT) {
-            Scan();
+class HazardDomain {
+private:
+    std::atomic<HazardRecord*> records_{nullptr};
+    std::atomic<uint64_t> slots_{0};
+
+    // nodes left behind by exited threads, freed by whoever scans next
+    std::mutex orphansMut_;
+    std::vector<Retired> orphans_;
+    std::atomic<uint64_t> orphanCount_{0};
+
+    // Frees what is not in the sorted hazard list, keeps the rest
+    static void FreeUnprotected(std::vector<Retired>& list, const std::vector<void*>& hazards) {
+        auto alive = std::partition(list.begin(), list.end(), [&hazards](const Retired& r) {
+            return std::binary_search(hazards.begin(), hazards.end(), r.ptr);
+        });
+        for (auto it = alive; it != list.end(); ++it) {
+            it->deleter(it->ptr);
         }
+        list.erase(alive, list.end());
     }
 
-    void Scan() {
-        uint64_t p = 0;
-        uint64_t newRCount = 0;
-        void* hptr;
-        void* hpList[TOTAL_HPTRS_COUNT];
-        void* newRetired[TOTAL_HPTRS_COUNT];
-
-        // Stage 1 – проходим по всем hptrs всех потоков
-        // Собираем общий массив hpList защищенных указателей
-        for (auto& thread : globalManagerRef) {
-            for (uint64_t i = 0; i < HPTRS_PER_THREAD; ++i) {
-                hptr = thread->hptrs[i];
-                if (hptr != nullptr) {
-                    hpList[p++] = hptr;
-                }
+public:
+    HazardDomain() = default;
+    HazardDomain(const HazardDomain&) = delete;
+    HazardDomain& operator=(const HazardDomain&) = delete;
+
+    ~HazardDomain() {
+        // called at exit, no reader can be active anymore
+        HazardRecord* rec = records_.load(std::memory_order_acquire);
+        while (rec != nullptr) {
+            HazardRecord* next = rec->next;
+            for (auto& r : rec->retired) {
+                r.deleter(r.ptr);
             }
+            delete rec;
+            rec = next;
+        }
+        for (auto& r : orphans_) {
+            r.deleter(r.ptr);
         }
+    }
 
-        // Stage 2 – сортировка hazard pointer'ов
-        // Сортировка нужна для последующего бинарного поиска
-        std::sort(hpList, hpList + TOTAL_HPTRS_COUNT);
-
-        // Stage 3 – удаление элементов, не объявленных как hazard
-        for (uint64_t i = 0; i < RETIRED_COUNT; ++i) {
-            // Если retired[i] отсутствует в списке hpList всех Hazard Pointer’ов
-            // то retired[i] может быть удален
-            if (std::binary_search(hpList, hpList + TOTAL_HPTRS_COUNT, retired[i])) {
-                newRetired[newRCount++] = retired[i];
-            } else {
-                free(retired[i]);
+    HazardRecord* AcquireRecord() {
+        for (HazardRecord* rec = records_.load(std::memory_order_acquire); rec != nullptr;
+             rec = rec->next) {
+            bool expected = false;
+            if (!rec->inUse.load(std::memory_order_relaxed) &&
+                rec->inUse.compare_exchange_strong(expected, true)) {
+                return rec;
             }
         }
 
-        // Stage 4 – формирование нового массива отложенных элементов.
-        for (uint64_t i = 0; i < newRCount; ++i) {
-            retired[i] = newRetired[i];
+        HazardRecord* rec = new HazardRecord;
+        rec->retired.reserve(MIN_RETIRED);
+        slots_.fetch_add(HPTRS_PER_THREAD, std::memory_order_relaxed);
+        HazardRecord* head = records_.load(std::memory_order_relaxed);
+        do {
+            rec->next = head;
+        } while (!records_.compare_exchange_weak(head, rec, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        return rec;
+    }
+
+    void ReleaseRecord(HazardRecord* rec) {
+        for (auto& hptr : rec->hptrs) {
+            hptr = nullptr;
+        }
+        if (!rec->retired.empty()) {
+            Scan(rec);
+        }
+        if (!rec->retired.empty()) {
+            std::lock_guard<std::mutex> guard(orphansMut_);
+            orphans_.insert(orphans_.end(), rec->retired.begin(), rec->retired.end());
+            orphanCount_.store(orphans_.size(), std::memory_order_relaxed);
+            rec->retired.clear();
+            rec->pending.store(0, std::memory_order_relaxed);
+        }
+        rec->inUse.store(false);
+    }
+
+    // Retired nodes a thread collects before it scans
+    uint64_t ScanThreshold() const {
+        return std::max(MIN_RETIRED, 2 * slots_.load(std::memory_order_relaxed));
+    }
+
+    void Retire(HazardRecord* rec, void* ptr, void (*deleter)(void*)) {
+        rec->retired.push_back({ptr, deleter});
+        if (rec->retired.size() >= ScanThreshold()) {
+            Scan(rec);
         }
+        rec->pending.store(rec->retired.size(), std::memory_order_relaxed);
+    }
 
-        rCount = newRCount;
+    void Scan(HazardRecord* rec) {
+        // Stage 1 - collect the hazard pointers of all records. Records are reused, so the
+        // list is as long as the peak number of threads, and free ones have their slots cleared.
+        std::vector<void*>& hazards = rec->hazards;
+        hazards.clear();
+        fence::Heavy();
+        for (HazardRecord* cur = records_.load(std::memory_order_acquire); cur != nullptr;
+             cur = cur->next) {
+            for (auto& hptr : cur->hptrs) {
+                void* ptr = hptr.Get();
+                if (ptr != nullptr) {
+                    hazards.push_back(ptr);
+                }
+            }
+        }
+
+        // Stage 2 - sort them for binary search
+        std::sort(hazards.begin(), hazards.end());
+
+        // Stage 3 - free the retired nodes nobody protects, own ones and orphaned ones
+        FreeUnprotected(rec->retired, hazards);
+
+        std::unique_lock<std::mutex> guard(orphansMut_, std::try_to_lock);
+        if (guard.owns_lock()) {
+            FreeUnprotected(orphans_, hazards);
+            orphanCount_.store(orphans_.size(), std::memory_order_relaxed);
+        }
+    }
+
+    // Nodes retired but not freed yet, a racy snapshot
+    uint64_t Pending() const {
+        uint64_t pending = orphanCount_.load(std::memory_order_relaxed);
+        for (HazardRecord* rec = records_.load(std::memory_order_acquire); rec != nullptr;
+             rec = rec->next) {
+            pending += rec->pending.load(std::memory_order_relaxed);
+        }
+        return pending;
+    }
+};
+
+inline HazardDomain globalDomain;
+
+// A thread's handle on its hazard record, taken on construction and given back at thread exit
+struct ThreadLocalHazardManager {
+    HazardRecord* rec = globalDomain.AcquireRecord();
+    std::array<HazardSlot, HPTRS_PER_THREAD>& hptrs = rec->hptrs;
+
+    ThreadLocalHazardManager() = default;
+    ThreadLocalHazardManager(const ThreadLocalHazardManager&) = delete;
+    ThreadLocalHazardManager& operator=(const ThreadLocalHazardManager&) = delete;
+
+    ~ThreadLocalHazardManager() {
+        globalDomain.ReleaseRecord(rec);
+    }
+
+    void RetireNode(void* node, void (*deleter)(void*)) {
+        globalDomain.Retire(rec, node, deleter);
+    }
+
+    // Deleter is a stateless callable taking T*, e.g. one that returns the node to its pool
+    template <typename T, typename Deleter = std::default_delete<T>>
+    void Retire(T* node, Deleter = {}) {
+        static_assert(std::is_empty_v<Deleter> && std::is_default_constructible_v<Deleter>,
+                      "the deleter is stored as a plain function pointer");
+        globalDomain.Retire(rec, node, [](void* ptr) {
+            Deleter{}(static_cast<T*>(ptr));
+        });
+    }
+
+    void Scan() {
+        globalDomain.Scan(rec);
     }
 };
 
+inline ThreadLocalHazardManager& LocalManager() {
+    thread_local ThreadLocalHazardManager manager;
+    return manager;
+}
 
 } // hp
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <lib/common/fence.h>
+
+// Quiescent-state based reclamation (QSBR).
+//
+// Readers do nothing at all while they access shared nodes. Instead every thread calls
+// Quiescent() at points where it holds no reference to any shared node - between two tasks of a
+// worker loop, say - and a thread that has registered must keep doing so, or reclamation
+// stalls. A node retired in epoch E is freed once every registered thread has passed a
+// quiescent state in a later epoch. Registration happens on first use and ends at thread exit.
+
+namespace qsbr {
+
+namespace {
+
+// seen value of a record that is not registered by any thread
+constexpr uint64_t OFFLINE = 0;
+constexpr uint64_t COLLECT_THRESHOLD = 64;
+// quiescent states between two collects while nothing of the thread's is known to be free
+constexpr uint64_t QUIESCENT_PER_COLLECT = 64;
+
+} // namespace
+
+struct Retired {
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;
+};
+
+struct alignas(CACHE_LINE) ThreadRecord {
+    // global epoch at the owner's last quiescent state
+    std::atomic<uint64_t> seen{OFFLINE};
+    std::atomic<bool> inUse{true};
+    // size of retired, for statistics
+    std::atomic<uint64_t> pending{0};
+    ThreadRecord* next = nullptr;
+
+    // owner-only part
+    std::vector<Retired> retired;
+    // retired[untagged..] still wait for their epoch, see TagRetired
+    uint64_t untagged = 0;
+    uint64_t collectAt = COLLECT_THRESHOLD;
+    uint64_t quiescentSinceCollect = 0;
+};
+
+class QuiescentDomain {
+private:
+    std::atomic<uint64_t> globalEpoch_{1};
+    // the highest OldestSeen() any collect has computed; it never goes down, since threads
+    // only announce later epochs and new ones start at the current one
+    std::atomic<uint64_t> frontier_{0};
+    std::atomic<ThreadRecord*> records_{nullptr};
+
+    // nodes left behind by exited threads, reclaimed by whoever collects next
+    std::mutex orphansMut_;
+    std::vector<Retired> orphans_;
+    std::atomic<uint64_t> orphanCount_{0};
+
+    static void FreeSafe(std::vector<Retired>& list, uint64_t oldestSeen) {
+        auto alive = std::partition(list.begin(), list.end(), [oldestSeen](const Retired& r) {
+            return r.epoch >= oldestSeen;
+        });
+        for (auto it = alive; it != list.end(); ++it) {
+            it->deleter(it->ptr);
+        }
+        list.erase(alive, list.end());
+    }
+
+    // A thread's own list is ordered by epoch, what can be freed is a prefix of it
+    static void FreeSafePrefix(std::vector<Retired>& list, uint64_t oldestSeen) {
+        auto alive = std::partition_point(list.begin(), list.end(), [oldestSeen](const Retired& r) {
+            return r.epoch < oldestSeen;
+        });
+        for (auto it = list.begin(); it != alive; ++it) {
+            it->deleter(it->ptr);
+        }
+        list.erase(list.begin(), alive);
+    }
+
+    // The oldest epoch some registered thread may still hold references from
+    uint64_t OldestSeen() {
+        fence::Heavy();
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        for (ThreadRecord* rec = records_.load(std::memory_order_acquire); rec != nullptr;
+             rec = rec->next) {
+            uint64_t seen = rec->seen.load(std::memory_order_acquire);
+            if (seen != OFFLINE) {
+                oldest = std::min(oldest, seen);
+            }
+        }
+        return oldest;
+    }
+
+public:
+    QuiescentDomain() = default;
+    QuiescentDomain(const QuiescentDomain&) = delete;
+    QuiescentDomain& operator=(const QuiescentDomain&) = delete;
+
+    ~QuiescentDomain() {
+        // called at exit, no reader can be active anymore
+        ThreadRecord* rec = records_.load(std::memory_order_acquire);
+        while (rec != nullptr) {
+            ThreadRecord* next = rec->next;
+            for (auto& r : rec->retired) {
+                r.deleter(r.ptr);
+            }
+            delete rec;
+            rec = next;
+        }
+        for (auto& r : orphans_) {
+            r.deleter(r.ptr);
+        }
+    }
+
+    ThreadRecord* AcquireRecord() {
+        ThreadRecord* rec = nullptr;
+        for (ThreadRecord* cur = records_.load(std::memory_order_acquire); cur != nullptr;
+             cur = cur->next) {
+            bool expected = false;
+            if (!cur->inUse.load(std::memory_order_relaxed) &&
+                cur->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                rec = cur;
+                break;
+            }
+        }
+
+        if (rec == nullptr) {
+            rec = new ThreadRecord;
+            ThreadRecord* head = records_.load(std::memory_order_relaxed);
+            do {
+                rec->next = head;
+            } while (!records_.compare_exchange_weak(head, rec, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+        }
+        // registering is a quiescent state: the thread holds no references yet
+        Announce(rec);
+        return rec;
+    }
+
+    // Stamps the nodes retired since the last call with the current epoch. A single fence
+    // orders all their unlinks before the epoch is read; stamping later than the unlink only
+    // delays the free, and the retire path stays free of fences.
+    void TagRetired(ThreadRecord* rec) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t epoch = globalEpoch_.load(std::memory_order_relaxed);
+        for (uint64_t i = rec->untagged; i < rec->retired.size(); ++i) {
+            rec->retired[i].epoch = epoch;
+        }
+        rec->untagged = rec->retired.size();
+    }
+
+    void ReleaseRecord(ThreadRecord* rec) {
+        if (!rec->retired.empty()) {
+            TagRetired(rec);
+            std::lock_guard<std::mutex> guard(orphansMut_);
+            orphans_.insert(orphans_.end(), rec->retired.begin(), rec->retired.end());
+            orphanCount_.store(orphans_.size(), std::memory_order_relaxed);
+            rec->retired.clear();
+            rec->untagged = 0;
+            rec->pending.store(0, std::memory_order_relaxed);
+        }
+        rec->seen.store(OFFLINE, std::memory_order_release);
+        rec->inUse.store(false, std::memory_order_release);
+    }
+
+    void Announce(ThreadRecord* rec) {
+        rec->seen.store(globalEpoch_.load(std::memory_order_acquire), std::memory_order_release);
+        // shared pointers read from here on must not be read before the announcement
+        fence::Light();
+    }
+
+    // Announces the quiescent state and frees what the other threads have let go of since the
+    // last one. Every collect costs a heavy fence, so as long as the list is below the Retire()
+    // threshold it collects only once the frontier has passed its oldest node - the first
+    // collect after a preempted thread comes back - or every QUIESCENT_PER_COLLECT quiescent
+    // states, in case nobody else collects. Waiting for the list to double instead would leave
+    // everybody with a huge threshold after a long preemption.
+    void Quiescent(ThreadRecord* rec) {
+        Announce(rec);
+        uint64_t size = rec->retired.size();
+        if (size < COLLECT_THRESHOLD) {
+            return;
+        }
+        bool freeable = rec->untagged > 0 &&
+                        rec->retired.front().epoch < frontier_.load(std::memory_order_relaxed);
+        if (size >= rec->collectAt || freeable ||
+            ++rec->quiescentSinceCollect >= QUIESCENT_PER_COLLECT) {
+            Collect(rec);
+            rec->collectAt = std::max<uint64_t>(COLLECT_THRESHOLD, 2 * rec->retired.size());
+            rec->pending.store(rec->retired.size(), std::memory_order_relaxed);
+        }
+    }
+
+    void Retire(ThreadRecord* rec, void* ptr, void (*deleter)(void*)) {
+        rec->retired.push_back({ptr, deleter, 0});
+        if (rec->retired.size() >= rec->collectAt) {
+            Collect(rec);
+            rec->collectAt = std::max<uint64_t>(COLLECT_THRESHOLD, 2 * rec->retired.size());
+        }
+        rec->pending.store(rec->retired.size(), std::memory_order_relaxed);
+    }
+
+    void Collect(ThreadRecord* rec) {
+        TagRetired(rec);
+        // quiescent states announced from now on are later than anything retired so far
+        globalEpoch_.fetch_add(1, std::memory_order_acq_rel);
+        uint64_t oldest = OldestSeen();
+        FreeSafePrefix(rec->retired, oldest);
+        rec->untagged = rec->retired.size();
+        rec->quiescentSinceCollect = 0;
+        uint64_t frontier = frontier_.load(std::memory_order_relaxed);
+        while (frontier < oldest &&
+               !frontier_.compare_exchange_weak(frontier, oldest, std::memory_order_relaxed)) {
+        }
+
+        std::unique_lock<std::mutex> guard(orphansMut_, std::try_to_lock);
+        if (guard.owns_lock()) {
+            FreeSafe(orphans_, oldest);
+            orphanCount_.store(orphans_.size(), std::memory_order_relaxed);
+        }
+    }
+
+    // Nodes retired but not freed yet, a racy snapshot
+    uint64_t Pending() const {
+        uint64_t pending = orphanCount_.load(std::memory_order_relaxed);
+        for (ThreadRecord* rec = records_.load(std::memory_order_acquire); rec != nullptr;
+             rec = rec->next) {
+            pending += rec->pending.load(std::memory_order_relaxed);
+        }
+        return pending;
+    }
+};
+
+inline QuiescentDomain globalDomain;
+
+struct ThreadHandle {
+    ThreadRecord* rec = globalDomain.AcquireRecord();
+
+    ~ThreadHandle() {
+        globalDomain.ReleaseRecord(rec);
+    }
+};
+
+inline ThreadRecord* LocalRecord() {
+    thread_local ThreadHandle handle;
+    return handle.rec;
+}
+
+// Declares that the calling thread holds no references to shared nodes right now
+inline void Quiescent() {
+    globalDomain.Quiescent(LocalRecord());
+}
+
+template <typename T>
+void Retire(T* ptr) {
+    globalDomain.Retire(LocalRecord(), ptr, [](void* p) {
+        delete static_cast<T*>(p);
+    });
+}
+
+inline void Retire(void* ptr, void (*deleter)(void*)) {
+    globalDomain.Retire(LocalRecord(), ptr, deleter);
+}
+
+} // namespace qsbr
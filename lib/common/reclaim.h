@@ -0,0 +1,117 @@
+#pragma once
+
+#include <lib/common/hazard.h>
+#include <lib/common/epoch.h>
+#include <lib/common/qsbr.h>
+
+// Memory reclamation policies for lock-free containers.
+//
+// A container opens a Guard for the duration of every operation, publishes each shared node
+// with guard.Protect(slot, node) before it validates and dereferences it, calls guard.Reset()
+// once it holds no node anymore, and passes unlinked nodes to Retire(). Quiescent() marks a
+// point where the calling thread holds no reference into any container; only QSBR needs it,
+// and the other policies ignore it. Pending() counts retired nodes that are not freed yet.
+//
+// HazardPointers: two fenced stores per protected node, bounded garbage even with stalled
+//                 threads.
+// EpochBased:     one fence per operation, readers never validate. A stalled reader holds
+//                 back everything retired after it entered.
+// QuiescentState: nothing per operation. Every thread that touches a container must call
+//                 Quiescent() regularly, e.g. between tasks, or nothing is freed.
+
+namespace reclaim {
+
+struct HazardPointers {
+    class Guard {
+    private:
+        hp::ThreadLocalHazardManager& manager_ = hp::LocalManager();
+
+    public:
+        Guard() = default;
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            Reset();
+        }
+
+        void Protect(size_t slot, void* ptr) {
+            manager_.hptrs[slot] = ptr;
+        }
+
+        void Reset() {
+            for (auto& hptr : manager_.hptrs) {
+                hptr = nullptr;
+            }
+        }
+    };
+
+    static void Retire(void* ptr, void (*deleter)(void*)) {
+        hp::LocalManager().RetireNode(ptr, deleter);
+    }
+
+    static void Quiescent() {
+    }
+
+    static uint64_t Pending() {
+        return hp::globalDomain.Pending();
+    }
+};
+
+struct EpochBased {
+    class Guard {
+    private:
+        ebr::Guard guard_;
+
+    public:
+        void Protect(size_t, void*) {
+        }
+
+        void Reset() {
+        }
+    };
+
+    static void Retire(void* ptr, void (*deleter)(void*)) {
+        ebr::Retire(ptr, deleter);
+    }
+
+    static void Quiescent() {
+    }
+
+    static uint64_t Pending() {
+        return ebr::globalDomain.Pending();
+    }
+};
+
+struct QuiescentState {
+    class Guard {
+    public:
+        // registers the thread, so its reads hold back reclamation until it quiesces
+        Guard() {
+            qsbr::LocalRecord();
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        void Protect(size_t, void*) {
+        }
+
+        void Reset() {
+        }
+    };
+
+    static void Retire(void* ptr, void (*deleter)(void*)) {
+        qsbr::Retire(ptr, deleter);
+    }
+
+    static void Quiescent() {
+        qsbr::Quiescent();
+    }
+
+    static uint64_t Pending() {
+        return qsbr::globalDomain.Pending();
+    }
+};
+
+} // namespace reclaim
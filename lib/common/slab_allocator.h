@@ -0,0 +1,204 @@
+#pragma once
+
+#include <lib/common/common.h>
+
+// Per-thread slab allocator for fixed-size nodes.
+//
+// Every thread keeps an intrusive free list of blocks per size class and serves allocate and
+// deallocate from it without any synchronization. Blocks are carved from slabs of
+// SLAB_BLOCKS nodes and are never handed back to malloc: a freed block goes to the free list
+// of the thread that frees it. When a thread hoards more than LOCAL_LIMIT blocks it spills a
+// batch to a shared depot, an empty thread refills from the depot before cutting a new slab,
+// and a thread that exits gives all its blocks to the depot.
+
+namespace slab {
+
+namespace {
+
+constexpr size_t SLAB_BLOCKS = 256;
+constexpr size_t TRANSFER_BATCH = 128;
+constexpr size_t LOCAL_LIMIT = 4 * TRANSFER_BATCH;
+
+} // namespace
+
+template <size_t Size, size_t Align>
+class Pool {
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t ALIGN = std::max(Align, alignof(FreeBlock));
+    static constexpr size_t BLOCK =
+            (std::max(Size, sizeof(FreeBlock)) + ALIGN - 1) / ALIGN * ALIGN;
+
+    // Shared between threads. Intentionally never destroyed: nodes may still be released
+    // from static destructors (e.g. ebr's domain) at exit.
+    struct Depot {
+        std::mutex mut;
+        std::vector<std::pair<FreeBlock*, size_t>> batches;
+    };
+
+    static Depot& depot() {
+        static Depot* instance = new Depot;
+        return *instance;
+    }
+
+    struct Local {
+        FreeBlock* head = nullptr;
+        size_t count = 0;
+
+        ~Local();
+    };
+
+    // trivially destructible, still readable after Local is gone
+    static inline thread_local bool localDead = false;
+
+    static Local& local() {
+        static thread_local Local instance;
+        return instance;
+    }
+
+    // Detaches up to n blocks from the front of the local list
+    static std::pair<FreeBlock*, size_t> Detach(Local& l, size_t n) {
+        FreeBlock* first = l.head;
+        FreeBlock* last = first;
+        size_t taken = 1;
+        for (; taken < n && last->next != nullptr; ++taken) {
+            last = last->next;
+        }
+        l.head = last->next;
+        l.count -= taken;
+        last->next = nullptr;
+        return {first, taken};
+    }
+
+    static void Spill(Local& l, size_t n) {
+        auto batch = Detach(l, n);
+        std::lock_guard<std::mutex> guard(depot().mut);
+        depot().batches.push_back(batch);
+    }
+
+    static void Refill(Local& l) {
+        {
+            std::lock_guard<std::mutex> guard(depot().mut);
+            if (!depot().batches.empty()) {
+                std::tie(l.head, l.count) = depot().batches.back();
+                depot().batches.pop_back();
+                return;
+            }
+        }
+
+        auto* slab =
+                static_cast<char*>(::operator new(BLOCK * SLAB_BLOCKS, std::align_val_t{ALIGN}));
+        for (size_t i = SLAB_BLOCKS; i-- > 0;) {
+            auto* block = reinterpret_cast<FreeBlock*>(slab + i * BLOCK);
+            block->next = l.head;
+            l.head = block;
+        }
+        l.count = SLAB_BLOCKS;
+    }
+
+public:
+    static void* Allocate() {
+        if (localDead) {
+            // the thread is exiting, its cache is gone: take a block from the depot or the heap
+            std::lock_guard<std::mutex> guard(depot().mut);
+            auto& batches = depot().batches;
+            if (batches.empty()) {
+                return ::operator new(BLOCK, std::align_val_t{ALIGN});
+            }
+            auto& [head, count] = batches.back();
+            FreeBlock* block = head;
+            head = block->next;
+            if (--count == 0) {
+                batches.pop_back();
+            }
+            return block;
+        }
+
+        Local& l = local();
+        if (l.head == nullptr) {
+            Refill(l);
+        }
+        FreeBlock* block = l.head;
+        l.head = block->next;
+        --l.count;
+        return block;
+    }
+
+    static void Deallocate(void* ptr) {
+        auto* block = static_cast<FreeBlock*>(ptr);
+        if (localDead) {
+            // the thread is exiting, its cache is gone
+            block->next = nullptr;
+            std::lock_guard<std::mutex> guard(depot().mut);
+            depot().batches.emplace_back(block, 1);
+            return;
+        }
+
+        Local& l = local();
+        block->next = l.head;
+        l.head = block;
+        if (++l.count > LOCAL_LIMIT) {
+            Spill(l, TRANSFER_BATCH);
+        }
+    }
+};
+
+template <size_t Size, size_t Align>
+Pool<Size, Align>::Local::~Local() {
+    localDead = true;
+    if (head != nullptr) {
+        Spill(*this, count);
+    }
+}
+
+// Pool's interface on top of plain aligned operator new / delete, one heap allocation per
+// node. The baseline pooling is measured against.
+template <size_t Size, size_t Align>
+struct Heap {
+    static void* Allocate() {
+        return ::operator new(Size, std::align_val_t{Align});
+    }
+
+    static void Deallocate(void* ptr) {
+        ::operator delete(ptr, std::align_val_t{Align});
+    }
+};
+
+} // namespace slab
+
+// std-compatible allocator on top of slab::Pool. Single objects come from the pool, arrays go
+// to the global allocator. Stateless, so any instance can free what another one allocated.
+template <typename T>
+struct slab_allocator {
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    slab_allocator() = default;
+
+    template <typename U>
+    slab_allocator(const slab_allocator<U>&) noexcept {
+    }
+
+    T* allocate(std::size_t n) {
+        if (n == 1) {
+            return static_cast<T*>(slab::Pool<sizeof(T), alignof(T)>::Allocate());
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        if (n == 1) {
+            slab::Pool<sizeof(T), alignof(T)>::Deallocate(ptr);
+            return;
+        }
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const slab_allocator<U>&) const noexcept {
+        return true;
+    }
+};
@@ -1,79 +1,674 @@
+#pragma once
+
 #include <lib/common/common.h>
+#include <lib/common/epoch.h>
+#include <lib/common/slab_allocator.h>
+
+// Point-in-time counters of a concurrent_hash_map, see concurrent_hash_map::stats()
+struct hash_map_stats {
+    size_t size = 0;
+    size_t capacity = 0;  // slots over all stripes, both tables while resizing
+    double load_factor = 0;
+    double mean_probe = 0;  // average distance of an entry from its home slot
+    size_t max_probe = 0;
+    uint64_t rehashes = 0;
+    uint64_t contended_locks = 0;  // writer lock acquisitions that had to wait
+    uint64_t lock_wait_ns = 0;     // total time writers spent waiting for stripe locks
+};
 
-template <typename Key, typename Val, typename Hasher = std::hash<Key>>
+// Lock-striped hash map with open addressing.
+//
+// Every stripe owns a mutex and its own flat, cache-line aligned array of slots, so writers
+// that land on different stripes never touch shared memory. The number of stripes is picked
+// at construction and defaults to a few per hardware thread. The user hash is scrambled once,
+// its top bits select the stripe and its low bits the home slot. Inside a stripe collisions
+// are resolved with linear probing and every stripe grows on its own once its load factor
+// goes above the limit.
+//
+// Lookups take no lock at all. A slot keeps the full hash next to an atomic pointer to an
+// immutable entry, a probe only dereferences entries whose hash matches. Writers publish
+// entries with release stores, erase leaves a tombstone instead of shifting the cluster, and
+// both unlinked entries and replaced slot tables are reclaimed through ebr, so a reader can
+// never step on freed memory however it interleaves with insert, erase or rehash.
+//
+// Resizing is incremental. When a stripe runs out of room a bigger table is published next to
+// the old one and every following insert or erase on that stripe moves at most MIGRATE_BATCH
+// slots across, so no single call pays for the whole rebuild. An entry is first copied into
+// the new table and only then tombstoned in the old one; readers probe the old table before
+// the new one, so a migrating entry is always seen in at least one of them.
+//
+// Entries are built in place by emplace/try_emplace/insert_or_assign, and probes compare the
+// stored key by reference. With a transparent Hasher and KeyEqual (both defining
+// is_transparent) every lookup also accepts any type the two can handle, e.g. std::string_view
+// for a std::string map, without materializing a Key.
+//
+// upsert/compute_if_present/compute_if_absent run a functor on the value under the stripe
+// lock. For ordinary values the functor works on a private copy that is then published as a
+// new entry. Integral values are the exception: they are updated in place through
+// std::atomic_ref, which is what lets fetch_add bump a counter without any lock while the
+// locked updates fall back to a CAS loop.
+//
+// Traversal never runs user code under a lock. for_each and parallel_for_each lock one stripe
+// at a time just long enough to collect its entry pointers, then call the functor on the
+// immutable entries under an ebr::Guard, so writers keep going and the result is consistent
+// per stripe only. snapshot() takes every stripe lock for the pointer collection alone, which
+// gives a single point in time; keys and values are copied after the locks are released.
+//
+// Entries come from Alloc, rebound to the internal node type. It must be stateless since
+// nodes are released from ebr callbacks that carry no allocator instance. The default
+// slab_allocator recycles erased nodes through per-thread free lists instead of malloc.
+//
+// The *_bulk calls hash a whole batch up front and bucket it by stripe, so each stripe lock is
+// taken once per batch and the home slots of upcoming keys are prefetched while the current
+// one is being processed.
+//
+// stats() reports occupancy, probe distances, resizes and lock contention. Probe distances are
+// measured on demand by walking the tables, the only always-on cost is the wait timer of a
+// writer that finds its stripe lock busy.
+template <typename Key, typename Val, typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Alloc = slab_allocator<std::pair<const Key, Val>>>
 class concurrent_hash_map {
 private:
     static constexpr size_t REHASH_MULTIPLIER = 2;
     static constexpr size_t INIT_BUCKETS = 8;
-    static constexpr size_t CHUNKS = 8;
+    static constexpr size_t STRIPES_PER_CORE = 4;
     static constexpr double INIT_MAX_LOAD_FACTOR = 0.618;
+    static constexpr size_t MIGRATE_BATCH = 16;
+    static constexpr size_t PREFETCH_DISTANCE = 4;
 
-    size_t buckets_;
-    size_t size_;
-    double max_load_factor_;
-    double load_factor_;
+    static constexpr bool TRANSPARENT = requires {
+        typename Hasher::is_transparent;
+        typename KeyEqual::is_transparent;
+    };
 
-    using ListKeyValHash = typename std::pair<std::pair<Key, Val>, size_t>;
-    using ListIt = typename std::list<ListKeyValHash>::iterator;
-    static constexpr auto gethash = [](const ListIt& it) -> size_t {
-        return it->second;
+    // integral values are mutated in place and must only be touched atomically
+    static constexpr bool ATOMIC_VAL = std::is_integral_v<Val>;
+
+    struct Node {
+        Key key;
+        Val val;
+
+        template <typename K, typename... Args>
+        explicit Node(K&& key, Args&&... args)
+                : key(std::forward<K>(key)),
+                  val(std::forward<Args>(args)...) {
+        }
     };
-    static constexpr auto getpair = [](const ListIt& it) -> std::pair<Key, Val> {
-        return it->first;
+
+    using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+    using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+    static_assert(NodeTraits::is_always_equal::value, "Alloc must be stateless");
+
+    template <typename... Args>
+    static Node* create_node(Args&&... args) {
+        NodeAlloc alloc;
+        Node* node = NodeTraits::allocate(alloc, 1);
+        try {
+            NodeTraits::construct(alloc, node, std::forward<Args>(args)...);
+        } catch (...) {
+            NodeTraits::deallocate(alloc, node, 1);
+            throw;
+        }
+        return node;
+    }
+
+    static void destroy_node(Node* node) {
+        NodeAlloc alloc;
+        NodeTraits::destroy(alloc, node);
+        NodeTraits::deallocate(alloc, node, 1);
+    }
+
+    static void retire_node(Node* node) {
+        ebr::Retire(node, [](void* ptr) {
+            destroy_node(static_cast<Node*>(ptr));
+        });
+    }
+
+    struct NodeDeleter {
+        void operator()(Node* node) const {
+            destroy_node(node);
+        }
+    };
+
+    using NodePtr = std::unique_ptr<Node, NodeDeleter>;
+
+    // never dereferenced, marks a slot whose entry was erased
+    static inline Node* const TOMBSTONE = reinterpret_cast<Node*>(alignof(Node));
+
+    struct Slot {
+        std::atomic<size_t> hash{};
+        std::atomic<Node*> node{nullptr};
+    };
+
+    struct Table {
+        size_t mask;
+        std::vector<Slot, cache_aligned_allocator<Slot>> slots;
+
+        explicit Table(size_t capacity): mask(capacity - 1), slots(capacity) {
+        }
+    };
+
+    struct alignas(CACHE_LINE) Stripe {
+        mutable std::mutex mut;
+        std::atomic<Table*> table{nullptr};
+        // table being drained into `table`, nullptr when no resize is running
+        std::atomic<Table*> old{nullptr};
+        // bumped whenever a resize starts, lets readers detect that they raced with one
+        std::atomic<uint64_t> resizes{0};
+        // guarded by mut
+        size_t size{};      // live entries in both tables
+        size_t used{};      // entries and tombstones in `table`
+        size_t migrated{};  // next slot of `old` to move
+        // lock contention, only updated by the thread that got the lock after waiting
+        uint64_t contended{};
+        uint64_t lockWaitNs{};
+    };
+
+    // Stripe lock for writers. The uncontended path is a plain try_lock, the clock is only
+    // read when the lock is busy, so the accounting costs nothing without contention.
+    class StripeLock {
+    private:
+        Stripe& stripe_;
+
+    public:
+        explicit StripeLock(Stripe& stripe): stripe_(stripe) {
+            if (stripe_.mut.try_lock()) {
+                return;
+            }
+            auto start = std::chrono::steady_clock::now();
+            stripe_.mut.lock();
+            auto waited = std::chrono::steady_clock::now() - start;
+            ++stripe_.contended;
+            stripe_.lockWaitNs += static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+        }
+
+        StripeLock(const StripeLock&) = delete;
+        StripeLock& operator=(const StripeLock&) = delete;
+
+        ~StripeLock() {
+            stripe_.mut.unlock();
+        }
     };
 
-    std::vector<ListIt> hash_table_;
-    mutable std::vector<std::recursive_mutex> locks_;
-    std::list<ListKeyValHash> list_;
+    double max_load_factor_;
+    size_t stripeBits_;
+    std::vector<Stripe> stripes_;
     Hasher hash_;
+    KeyEqual eq_;
+
+    static size_t round_up_pow2(size_t n) {
+        size_t res = 1;
+        while (res < n) {
+            res <<= 1;
+        }
+        return res;
+    }
+
+    static size_t log2(size_t n) {
+        size_t res = 0;
+        while ((size_t{1} << res) < n) {
+            ++res;
+        }
+        return res;
+    }
+
+    static size_t default_stripes() {
+        size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+        return round_up_pow2(cores * STRIPES_PER_CORE);
+    }
+
+    // std::hash is the identity for integers, so its high bits are useless until mixed
+    template <typename K>
+    size_t hash_of(const K& key) const {
+        uint64_t h = static_cast<uint64_t>(hash_(key));
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return static_cast<size_t>(h);
+    }
+
+    // the top bits pick the stripe, the home slot comes from the low bits
+    size_t stripe_index(size_t hashValue) const {
+        return stripeBits_ == 0 ? 0 : hashValue >> (sizeof(size_t) * 8 - stripeBits_);
+    }
+
+    Stripe& stripe_of(size_t hashValue) {
+        return stripes_[stripe_index(hashValue)];
+    }
+
+    const Stripe& stripe_of(size_t hashValue) const {
+        return stripes_[stripe_index(hashValue)];
+    }
+
+    static size_t home_of(size_t hashValue, size_t mask) {
+        return hashValue & mask;
+    }
+
+    static bool is_entry(const Node* node) {
+        return node != nullptr && node != TOMBSTONE;
+    }
+
+    static std::atomic_ref<Val> val_ref(Node* node) requires ATOMIC_VAL {
+        return std::atomic_ref<Val>(node->val);
+    }
+
+    // Consistent copy of the value, safe against concurrent in-place updates
+    static Val load_val(Node* node) {
+        if constexpr (ATOMIC_VAL) {
+            return val_ref(node).load(std::memory_order_acquire);
+        } else {
+            return node->val;
+        }
+    }
+
+    // Safe to run concurrently with writers as long as the caller holds an ebr::Guard
+    template <typename K>
+    Node* find_node(const Table* table, const K& key, size_t hashValue) const {
+        for (size_t i = home_of(hashValue, table->mask);; i = (i + 1) & table->mask) {
+            const Slot& slot = table->slots[i];
+            Node* node = slot.node.load(std::memory_order_acquire);
+            if (node == nullptr) {
+                return nullptr;
+            }
+            if (node != TOMBSTONE && slot.hash.load(std::memory_order_relaxed) == hashValue &&
+                eq_(node->key, key)) {
+                return node;
+            }
+        }
+    }
+
+    // Lock-free lookup across both tables of a stripe. A hit is always valid; a miss is only
+    // trusted when no resize started meanwhile, otherwise the entry might have been moved
+    // twice behind our back. Each retry means the stripe grew, so retries are rare.
+    template <typename K>
+    Node* find_node(const Stripe& stripe, const K& key, size_t hashValue) const {
+        while (true) {
+            uint64_t resizes = stripe.resizes.load(std::memory_order_acquire);
+            Table* old = stripe.old.load(std::memory_order_acquire);
+            Table* table = stripe.table.load(std::memory_order_acquire);
+            if (old != nullptr) {
+                if (Node* node = find_node(old, key, hashValue)) {
+                    return node;
+                }
+            }
+            if (Node* node = find_node(table, key, hashValue)) {
+                return node;
+            }
+            if (stripe.resizes.load(std::memory_order_acquire) == resizes) {
+                return nullptr;
+            }
+        }
+    }
+
+    // Writers only: returns the slot holding key, or nullptr
+    template <typename K>
+    Slot* find_slot(Table* table, const K& key, size_t hashValue) const {
+        for (size_t i = home_of(hashValue, table->mask);; i = (i + 1) & table->mask) {
+            Slot& slot = table->slots[i];
+            Node* node = slot.node.load(std::memory_order_relaxed);
+            if (node == nullptr) {
+                return nullptr;
+            }
+            if (node != TOMBSTONE && slot.hash.load(std::memory_order_relaxed) == hashValue &&
+                eq_(node->key, key)) {
+                return &slot;
+            }
+        }
+    }
+
+    // Writers only: fills the first free or erased slot of the probe chain.
+    // Returns true when a tombstone was reused.
+    static bool place(Table* table, size_t hashValue, Node* node) {
+        size_t i = home_of(hashValue, table->mask);
+        Node* cur = table->slots[i].node.load(std::memory_order_relaxed);
+        while (is_entry(cur)) {
+            i = (i + 1) & table->mask;
+            cur = table->slots[i].node.load(std::memory_order_relaxed);
+        }
+        table->slots[i].hash.store(hashValue, std::memory_order_relaxed);
+        table->slots[i].node.store(node, std::memory_order_release);
+        return cur == TOMBSTONE;
+    }
+
+    bool overloaded(size_t used, size_t capacity) const {
+        return static_cast<double>(used) > max_load_factor_ * static_cast<double>(capacity);
+    }
+
+    // Writers only: looks key up in both tables of a resizing stripe
+    template <typename K>
+    Slot* find_slot(const Stripe& stripe, const K& key, size_t hashValue) const {
+        Table* old = stripe.old.load(std::memory_order_relaxed);
+        if (old != nullptr) {
+            if (Slot* slot = find_slot(old, key, hashValue)) {
+                return slot;
+            }
+        }
+        return find_slot(stripe.table.load(std::memory_order_relaxed), key, hashValue);
+    }
+
+    // Moves up to `batch` slots of the old table into the current one
+    void migrate(Stripe& stripe, size_t batch) {
+        Table* old = stripe.old.load(std::memory_order_relaxed);
+        if (old == nullptr) {
+            return;
+        }
+
+        Table* table = stripe.table.load(std::memory_order_relaxed);
+        size_t end = old->mask + 1;
+        if (end - stripe.migrated > batch) {
+            end = stripe.migrated + batch;
+        }
+        for (; stripe.migrated < end; ++stripe.migrated) {
+            Slot& slot = old->slots[stripe.migrated];
+            Node* node = slot.node.load(std::memory_order_relaxed);
+            if (is_entry(node)) {
+                if (!place(table, slot.hash.load(std::memory_order_relaxed), node)) {
+                    ++stripe.used;
+                }
+                // published in the new table first, readers check the old one before it
+                slot.node.store(TOMBSTONE, std::memory_order_release);
+            }
+        }
+
+        if (stripe.migrated == old->mask + 1) {
+            stripe.old.store(nullptr, std::memory_order_release);
+            ebr::Retire(old);
+        }
+    }
+
+    // Publishes an empty table next to the current one. Live entries are carried over by
+    // the following writers, a stripe that is mostly tombstones is rebuilt at the same size.
+    void start_resize(Stripe& stripe) {
+        // a resize still in flight must be finished first, there are only two tables at a time
+        migrate(stripe, SIZE_MAX);
+
+        Table* table = stripe.table.load(std::memory_order_relaxed);
+        size_t capacity = table->mask + 1;
+        if (stripe.size * 2 > stripe.used) {
+            capacity *= REHASH_MULTIPLIER;
+        }
+        while (overloaded(stripe.size + 1, capacity)) {
+            capacity *= REHASH_MULTIPLIER;
+        }
+
+        stripe.resizes.fetch_add(1, std::memory_order_release);
+        stripe.old.store(table, std::memory_order_release);
+        stripe.table.store(new Table(capacity), std::memory_order_release);
+        stripe.used = 0;
+        stripe.migrated = 0;
+    }
+
+    // Writers only: the stripe lock must be held and key must not be in the stripe
+    void add_locked(Stripe& stripe, size_t hashValue, Node* node) {
+        Table* table = stripe.table.load(std::memory_order_relaxed);
+        if (overloaded(stripe.used + 1, table->mask + 1)) {
+            start_resize(stripe);
+            table = stripe.table.load(std::memory_order_relaxed);
+        }
+
+        if (!place(table, hashValue, node)) {
+            ++stripe.used;
+        }
+        ++stripe.size;
+    }
+
+    // Writers only: the stripe lock must be held. The entry is built only if key is absent.
+    template <typename K, typename... Args>
+    bool try_emplace_locked(Stripe& stripe, size_t hashValue, K&& key, Args&&... args) {
+        migrate(stripe, MIGRATE_BATCH);
+
+        if (find_slot(stripe, key, hashValue) != nullptr) {
+            return false;
+        }
+
+        add_locked(stripe, hashValue,
+                   create_node(std::forward<K>(key), std::forward<Args>(args)...));
+        return true;
+    }
+
+    // Writers only: the stripe lock must be held. Entries are immutable, so assigning
+    // publishes a new entry in the same slot and retires the old one.
+    template <typename K, typename M>
+    bool insert_or_assign_locked(Stripe& stripe, size_t hashValue, K&& key, M&& val) {
+        migrate(stripe, MIGRATE_BATCH);
+
+        if (Slot* slot = find_slot(stripe, key, hashValue)) {
+            if constexpr (ATOMIC_VAL) {
+                val_ref(slot->node.load(std::memory_order_relaxed))
+                        .store(std::forward<M>(val), std::memory_order_release);
+            } else {
+                replace(*slot, create_node(std::forward<K>(key), std::forward<M>(val)));
+            }
+            return false;
+        }
+
+        add_locked(stripe, hashValue, create_node(std::forward<K>(key), std::forward<M>(val)));
+        return true;
+    }
+
+    // Writers only: the stripe lock must be held
+    static void replace(Slot& slot, Node* node) {
+        Node* prev = slot.node.load(std::memory_order_relaxed);
+        slot.node.store(node, std::memory_order_release);
+        retire_node(prev);
+    }
+
+    // Writers only: the stripe lock must be held. Runs fn(Val&) on the entry held by slot.
+    // Integral values may race with a lock-free fetch_add, so fn can run more than once.
+    template <typename Func>
+    static void update_locked(Slot& slot, Func& fn) {
+        Node* node = slot.node.load(std::memory_order_relaxed);
+        if constexpr (ATOMIC_VAL) {
+            std::atomic_ref<Val> ref = val_ref(node);
+            Val cur = ref.load(std::memory_order_relaxed);
+            Val next;
+            do {
+                next = cur;
+                fn(next);
+            } while (!ref.compare_exchange_weak(cur, next, std::memory_order_acq_rel,
+                                                std::memory_order_relaxed));
+        } else {
+            NodePtr copy(create_node(node->key, node->val));
+            fn(copy->val);
+            replace(slot, copy.release());
+        }
+    }
+
+    // Writers only: the stripe lock must be held
+    template <typename K>
+    bool erase_locked(Stripe& stripe, size_t hashValue, const K& key) {
+        migrate(stripe, MIGRATE_BATCH);
+
+        Slot* slot = find_slot(stripe, key, hashValue);
+        if (slot == nullptr) {
+            return false;
+        }
+
+        Node* node = slot->node.load(std::memory_order_relaxed);
+        slot->node.store(TOMBSTONE, std::memory_order_release);
+        --stripe.size;
+        retire_node(node);
+        return true;
+    }
+
+    static void prefetch_home(const Stripe& stripe, size_t hashValue) {
+        const Table* table = stripe.table.load(std::memory_order_acquire);
+        prefetch(&table->slots[home_of(hashValue, table->mask)]);
+    }
+
+    template <typename Iter>
+    struct Batch {
+        std::vector<std::pair<size_t, Iter>> items;  // (hash, element), ordered by stripe
+        std::vector<size_t> offsets;                 // stripe i owns [offsets[i], offsets[i+1])
+    };
+
+    // Hashes every element once and counting-sorts the batch by stripe
+    template <typename Iter, typename KeyOf>
+    Batch<Iter> group_by_stripe(Iter first, Iter last, KeyOf keyOf) const {
+        std::vector<std::pair<size_t, Iter>> hashed;
+        for (; first != last; ++first) {
+            hashed.emplace_back(hash_of(keyOf(*first)), first);
+        }
+
+        Batch<Iter> batch{std::vector<std::pair<size_t, Iter>>(hashed.size()),
+                          std::vector<size_t>(stripes_.size() + 1, 0)};
+        for (const auto& item : hashed) {
+            ++batch.offsets[stripe_index(item.first) + 1];
+        }
+        for (size_t i = 1; i < batch.offsets.size(); ++i) {
+            batch.offsets[i] += batch.offsets[i - 1];
+        }
+        std::vector<size_t> cursor(batch.offsets.begin(), batch.offsets.end() - 1);
+        for (auto& item : hashed) {
+            batch.items[cursor[stripe_index(item.first)]++] = std::move(item);
+        }
+        return batch;
+    }
+
+    // Runs fn(stripe, hash, element) for every element, holding each stripe lock once
+    template <typename Iter, typename Func>
+    size_t apply_locked(Batch<Iter>& batch, Func&& fn) {
+        size_t done = 0;
+        for (size_t idx = 0; idx < stripes_.size(); ++idx) {
+            size_t begin = batch.offsets[idx];
+            size_t end = batch.offsets[idx + 1];
+            if (begin == end) {
+                continue;
+            }
 
-    void lock_all() {
-        for (auto mut = locks_.begin(); mut != locks_.end(); ++mut) {
-            mut->lock();
+            Stripe& stripe = stripes_[idx];
+            StripeLock guard(stripe);
+            for (size_t i = begin; i < end; ++i) {
+                if (i + PREFETCH_DISTANCE < end) {
+                    prefetch_home(stripe, batch.items[i + PREFETCH_DISTANCE].first);
+                }
+                if (fn(stripe, batch.items[i].first, *batch.items[i].second)) {
+                    ++done;
+                }
+            }
         }
+        return done;
+    }
+
+    template <typename K>
+    bool erase_impl(const K& key) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        return erase_locked(stripe, hashValue, key);
     }
 
-    void unlock_all() {
-        for (auto rmut = locks_.rbegin(); rmut != locks_.rend(); ++rmut) {
-            rmut->lock();
+    template <typename K, typename Func>
+    bool visit_impl(const K& key, Func&& fn) const {
+        size_t hashValue = hash_of(key);
+        const Stripe& stripe = stripe_of(hashValue);
+
+        ebr::Guard guard;
+        Node* node = find_node(stripe, key, hashValue);
+        if (node == nullptr) {
+            return false;
+        }
+        if constexpr (ATOMIC_VAL) {
+            fn(static_cast<const Val&>(load_val(node)));
+        } else {
+            fn(static_cast<const Val&>(node->val));
         }
+        return true;
     }
 
-    void recalc_load_factor() {
-        load_factor_ = static_cast<double>(size_) / static_cast<double>(buckets_);
+    template <typename K>
+    std::optional<Val> find_impl(const K& key) const {
+        std::optional<Val> res;
+        visit_impl(key, [&res](const Val& val) {
+            res.emplace(val);
+        });
+        return res;
     }
 
-    void rehash() {
-        lock_all();
+    template <typename K>
+    Val get_or_impl(const K& key, const Val& defaultVal) const {
+        Val res = defaultVal;
+        visit_impl(key, [&res](const Val& val) {
+            res = val;
+        });
+        return res;
+    }
 
-        buckets_ *= REHASH_MULTIPLIER;
-        std::vector<ListIt> new_hash_table(buckets_, list_.end());
-        std::swap(hash_table_, new_hash_table);
-        ListIt iterator = list_.begin();
-        size_t previousHashID = gethash(iterator) % buckets_;
-        hash_table_[previousHashID] = iterator;
-        ++iterator;
-        for (; iterator != list_.end(); ++iterator) {
-            size_t currentHashID = gethash(iterator) % buckets_;
-            if (currentHashID != previousHashID) {
-                hash_table_[currentHashID] = iterator;
+    // Writers only: the stripe lock must be held. Appends every live entry of both tables,
+    // entries already moved out of the old one are tombstones there, so none is seen twice.
+    static void collect_locked(const Stripe& stripe, std::vector<Node*>& out) {
+        out.reserve(out.size() + stripe.size);
+        for (Table* table : {stripe.old.load(std::memory_order_relaxed),
+                             stripe.table.load(std::memory_order_relaxed)}) {
+            if (table == nullptr) {
+                continue;
+            }
+            for (const auto& slot : table->slots) {
+                Node* node = slot.node.load(std::memory_order_relaxed);
+                if (is_entry(node)) {
+                    out.push_back(node);
+                }
             }
-            previousHashID = currentHashID;
         }
+    }
 
-        recalc_load_factor();
+    // Calls fn(const Key&, const Val&) on every entry of the stripe, outside of its lock
+    template <typename Func>
+    void for_each_in_stripe(const Stripe& stripe, Func& fn, std::vector<Node*>& nodes) const {
+        nodes.clear();
 
-        unlock_all();
+        ebr::Guard guard;
+        {
+            std::lock_guard<std::mutex> lock(stripe.mut);
+            collect_locked(stripe, nodes);
+        }
+
+        for (Node* node : nodes) {
+            if constexpr (ATOMIC_VAL) {
+                fn(static_cast<const Key&>(node->key), static_cast<const Val&>(load_val(node)));
+            } else {
+                fn(static_cast<const Key&>(node->key), static_cast<const Val&>(node->val));
+            }
+        }
+    }
+
+    static void destroy(Table* table) {
+        for (auto& slot : table->slots) {
+            Node* node = slot.node.load(std::memory_order_relaxed);
+            if (is_entry(node)) {
+                destroy_node(node);
+            }
+        }
+        delete table;
+    }
+
+    // Same as destroy(), but for a table readers may still be walking
+    static void retire_with_entries(Table* table) {
+        for (auto& slot : table->slots) {
+            Node* node = slot.node.load(std::memory_order_relaxed);
+            if (is_entry(node)) {
+                retire_node(node);
+            }
+        }
+        ebr::Retire(table);
     }
 
 public:
-    concurrent_hash_map(size_t buckets = INIT_BUCKETS)
-            : buckets_(buckets),
-              size_(0),
-              max_load_factor_(INIT_MAX_LOAD_FACTOR),
-              load_factor_(0.0),
-              hash_table_(buckets_, list_.end()),
-              locks_(CHUNKS) {
+    // `stripes` is rounded up to a power of two, 0 picks a default based on the core count
+    explicit concurrent_hash_map(size_t buckets = 0, size_t stripes = 0)
+            : max_load_factor_(INIT_MAX_LOAD_FACTOR),
+              stripeBits_(log2(stripes == 0 ? default_stripes() : stripes)),
+              stripes_(size_t{1} << stripeBits_) {
+        size_t perStripe = round_up_pow2(std::max(INIT_BUCKETS, buckets >> stripeBits_));
+        for (auto& stripe : stripes_) {
+            stripe.table.store(new Table(perStripe), std::memory_order_relaxed);
+        }
     }
 
     concurrent_hash_map(std::initializer_list<std::pair<Key, Val>> InitList)
@@ -82,138 +677,441 @@ public:
     }
 
     template <typename Iter>
+        requires std::forward_iterator<Iter>
     concurrent_hash_map(Iter first, Iter last)
             : concurrent_hash_map(first, last,
-                                  static_cast<size_t>((1.0 / INIT_MAX_LOAD_FACTOR) * 2.0 *
-                                                      std::distance(last, first))) {
+                                  static_cast<size_t>((1.0 / INIT_MAX_LOAD_FACTOR) *
+                                                      std::distance(first, last))) {
     }
 
     template <typename Iter>
-    concurrent_hash_map(Iter first, Iter last, size_t buckets): concurrent_hash_map(buckets) {
+        requires std::forward_iterator<Iter>
+    concurrent_hash_map(Iter first, Iter last, size_t buckets, size_t stripes = 0)
+            : concurrent_hash_map(buckets, stripes) {
         insert(first, last);
     }
 
+    concurrent_hash_map(const concurrent_hash_map&) = delete;
+    concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
     ~concurrent_hash_map() {
+        for (auto& stripe : stripes_) {
+            if (Table* old = stripe.old.load(std::memory_order_relaxed)) {
+                destroy(old);
+            }
+            destroy(stripe.table.load(std::memory_order_relaxed));
+        }
     }
 
     ///////////////////////////////////////////////////////////////////////////////////////////////
 
-    void insert(const std::pair<Key, Val>& pairKeyVal) {
-        const auto& [key, val] = pairKeyVal;
-        size_t hashValue = hash_(key);
+    bool insert(const std::pair<Key, Val>& pairKeyVal) {
+        return try_emplace(pairKeyVal.first, pairKeyVal.second);
+    }
 
-        std::lock_guard<std::recursive_mutex> guard(locks_[hashValue / buckets_]);
+    bool insert(std::pair<Key, Val>&& pairKeyVal) {
+        return try_emplace(std::move(pairKeyVal.first), std::move(pairKeyVal.second));
+    }
 
-        size_t hashPresentID = hashValue % buckets_;
-        size_t hashFutureID = hashValue % (buckets_ * REHASH_MULTIPLIER);
-        auto& bucket = hash_table_[hashPresentID];
+    void insert(std::initializer_list<std::pair<Key, Val>> InitList) {
+        insert_bulk(InitList.begin(), InitList.end());
+    }
 
-        if (bucket == list_.end()) {
-            list_.push_front({pairKeyVal, hashValue});
-            bucket = list_.begin();
-        } else {
-            auto it = bucket;
-            for (; it != list_.end() && hashPresentID == gethash(it) % buckets_; ++it) {
-                if (getpair(it).first == key) {
-                    return;
-                }
-            }
+    template <typename Iter>
+        requires std::forward_iterator<Iter>
+    void insert(Iter first, Iter last) {
+        insert_bulk(first, last);
+    }
 
-            //-------------------------------------------------------------------------------------
-            // for the sake of more convenient rehash:
-            //
-            // present => { HashKey % curSize == HashKey % afterRehashSize } - stays
-            //            { HashKey % curSize == HashKey % afterRehashSize } - stays
-            //            ...
-            //  future => { HashKey % curSize != HashKey % afterRehashSize } - moves
-            //            { HashKey % curSize != HashKey % afterRehashSize } - moves
-            //            ...
-            //-------------------------------------------------------------------------------------
+    // Single-pass input cannot be batched, its elements go in one at a time
+    template <typename Iter>
+        requires(std::input_iterator<Iter> && !std::forward_iterator<Iter>)
+    void insert(Iter first, Iter last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
 
-            if (hashPresentID == hashFutureID) {
-                bucket = list_.insert(bucket, {pairKeyVal, hashValue});
-            } else {
-                list_.insert(it, {pairKeyVal, hashValue});
-            }
+    // Builds the entry before taking the lock and drops it if the key is already present
+    template <typename K, typename... Args>
+    bool emplace(K&& key, Args&&... args) {
+        NodePtr node(create_node(std::forward<K>(key), std::forward<Args>(args)...));
+        size_t hashValue = hash_of(node->key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        migrate(stripe, MIGRATE_BATCH);
+        if (find_slot(stripe, node->key, hashValue) != nullptr) {
+            return false;
         }
+        add_locked(stripe, hashValue, node.release());
+        return true;
+    }
+
+    // Leaves key and args untouched if the key is already present
+    template <typename... Args>
+    bool try_emplace(const Key& key, Args&&... args) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
 
-        ++size_;
-        recalc_load_factor();
+        StripeLock guard(stripe);
+        return try_emplace_locked(stripe, hashValue, key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool try_emplace(Key&& key, Args&&... args) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        return try_emplace_locked(stripe, hashValue, std::move(key),
+                                  std::forward<Args>(args)...);
+    }
 
-        if (load_factor_ > max_load_factor_) {
-            rehash();
+    // Returns true if a new entry was inserted, false if an existing one was replaced
+    template <typename M>
+    bool insert_or_assign(const Key& key, M&& val) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        return insert_or_assign_locked(stripe, hashValue, key, std::forward<M>(val));
+    }
+
+    template <typename M>
+    bool insert_or_assign(Key&& key, M&& val) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        return insert_or_assign_locked(stripe, hashValue, std::move(key), std::forward<M>(val));
+    }
+
+    // Runs fn(Val&) on the value of key, inserting a value-initialized Val first if the key
+    // is absent. Returns true if the entry was inserted.
+    template <typename Func>
+    bool upsert(const Key& key, Func&& fn) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        migrate(stripe, MIGRATE_BATCH);
+
+        if (Slot* slot = find_slot(stripe, key, hashValue)) {
+            update_locked(*slot, fn);
+            return false;
+        }
+
+        NodePtr node(create_node(key));
+        fn(node->val);
+        add_locked(stripe, hashValue, node.release());
+        return true;
+    }
+
+    // Runs fn(Val&) on the value of key if it is present
+    template <typename Func>
+    bool compute_if_present(const Key& key, Func&& fn) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        migrate(stripe, MIGRATE_BATCH);
+
+        Slot* slot = find_slot(stripe, key, hashValue);
+        if (slot == nullptr) {
+            return false;
         }
+        update_locked(*slot, fn);
+        return true;
     }
 
-    void insert(std::initializer_list<std::pair<Key, Val>> InitList) {
-        for (const auto& pairKeyVal : InitList) {
-            insert(pairKeyVal);
+    // Inserts fn() under key if it is absent, fn is not called otherwise
+    template <typename Func>
+    bool compute_if_absent(const Key& key, Func&& fn) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        StripeLock guard(stripe);
+        migrate(stripe, MIGRATE_BATCH);
+
+        if (find_slot(stripe, key, hashValue) != nullptr) {
+            return false;
+        }
+        add_locked(stripe, hashValue, create_node(key, fn()));
+        return true;
+    }
+
+    // Counter path for integral values. Adds delta to the value of key and returns the
+    // previous value; an existing key is bumped with a single atomic RMW and no lock, an
+    // absent key is inserted with value delta under the stripe lock and 0 is returned.
+    Val fetch_add(const Key& key, Val delta) requires(ATOMIC_VAL && !std::is_same_v<Val, bool>) {
+        size_t hashValue = hash_of(key);
+        Stripe& stripe = stripe_of(hashValue);
+
+        {
+            ebr::Guard guard;
+            if (Node* node = find_node(stripe, key, hashValue)) {
+                return val_ref(node).fetch_add(delta, std::memory_order_acq_rel);
+            }
+        }
+
+        StripeLock guard(stripe);
+        migrate(stripe, MIGRATE_BATCH);
+
+        if (Slot* slot = find_slot(stripe, key, hashValue)) {
+            return val_ref(slot->node.load(std::memory_order_relaxed))
+                    .fetch_add(delta, std::memory_order_acq_rel);
         }
+        add_locked(stripe, hashValue, create_node(key, delta));
+        return Val{};
     }
 
+    bool erase(const Key& key) {
+        return erase_impl(key);
+    }
+
+    template <typename K>
+        requires TRANSPARENT
+    bool erase(const K& key) {
+        return erase_impl(key);
+    }
+
+    void erase(std::initializer_list<Key> InitList) {
+        erase_bulk(InitList.begin(), InitList.end());
+    }
+
+    // Batched writers: [first, last) is walked twice, so Iter must be a forward iterator.
+    // Both return how many elements were actually inserted / erased.
+
     template <typename Iter>
-    void insert(Iter first, Iter last) {
+        requires std::forward_iterator<Iter>
+    size_t insert_bulk(Iter first, Iter last) {
+        auto batch = group_by_stripe(first, last, [](const auto& pairKeyVal) -> const Key& {
+            return pairKeyVal.first;
+        });
+        return apply_locked(batch, [this](Stripe& stripe, size_t hashValue,
+                                          const auto& pairKeyVal) {
+            return try_emplace_locked(stripe, hashValue, pairKeyVal.first, pairKeyVal.second);
+        });
+    }
+
+    template <typename Iter>
+        requires std::forward_iterator<Iter>
+    size_t erase_bulk(Iter first, Iter last) {
+        auto batch = group_by_stripe(first, last, [](const auto& key) -> const auto& {
+            return key;
+        });
+        return apply_locked(batch, [this](Stripe& stripe, size_t hashValue, const auto& key) {
+            return erase_locked(stripe, hashValue, key);
+        });
+    }
+
+    // Lock-free read path: none of the calls below takes a stripe lock
+
+    bool contains(const Key& key) const {
+        return visit_impl(key, [](const Val&) {});
+    }
+
+    template <typename K>
+        requires TRANSPARENT
+    bool contains(const K& key) const {
+        return visit_impl(key, [](const Val&) {});
+    }
+
+    std::optional<Val> find(const Key& key) const {
+        return find_impl(key);
+    }
+
+    template <typename K>
+        requires TRANSPARENT
+    std::optional<Val> find(const K& key) const {
+        return find_impl(key);
+    }
+
+    Val get_or(const Key& key, const Val& defaultVal) const {
+        return get_or_impl(key, defaultVal);
+    }
+
+    template <typename K>
+        requires TRANSPARENT
+    Val get_or(const K& key, const Val& defaultVal) const {
+        return get_or_impl(key, defaultVal);
+    }
+
+    // Calls fn(const Val&) on the entry while it is protected from reclamation.
+    // fn must not keep references to the value after it returns.
+    template <typename Func>
+    bool visit(const Key& key, Func&& fn) const {
+        return visit_impl(key, std::forward<Func>(fn));
+    }
+
+    template <typename K, typename Func>
+        requires TRANSPARENT
+    bool visit(const K& key, Func&& fn) const {
+        return visit_impl(key, std::forward<Func>(fn));
+    }
+
+    // Looks up every key of [first, last) under a single read-side critical section.
+    // Results come back in input order.
+    template <typename Iter>
+        requires std::forward_iterator<Iter>
+    std::vector<std::optional<Val>> find_bulk(Iter first, Iter last) const {
+        std::vector<std::pair<size_t, Iter>> hashed;
         for (; first != last; ++first) {
-            insert(*first);
+            hashed.emplace_back(hash_of(*first), first);
         }
-    }
 
-    void erase(const Key& key) {
-        size_t hashValue = hash_(key);
+        std::vector<std::optional<Val>> res(hashed.size());
 
-        std::lock_guard<std::recursive_mutex> guard(locks_[hashValue / buckets_]);
+        ebr::Guard guard;
+        for (size_t i = 0; i < hashed.size(); ++i) {
+            if (i + PREFETCH_DISTANCE < hashed.size()) {
+                size_t ahead = hashed[i + PREFETCH_DISTANCE].first;
+                prefetch_home(stripe_of(ahead), ahead);
+            }
+            const auto& [hashValue, it] = hashed[i];
+            if (Node* node = find_node(stripe_of(hashValue), *it, hashValue)) {
+                res[i].emplace(load_val(node));
+            }
+        }
+        return res;
+    }
 
-        size_t hashPresentID = hashValue % buckets_;
-        auto& bucket = hash_table_[hashPresentID];
+    // Weakly consistent traversal: every entry present for the whole call is visited once,
+    // entries inserted or erased meanwhile may or may not be. fn(const Key&, const Val&)
+    // must not call back into writers of this map.
+    template <typename Func>
+    void for_each(Func&& fn) const {
+        std::vector<Node*> nodes;
+        for (const auto& stripe : stripes_) {
+            for_each_in_stripe(stripe, fn, nodes);
+        }
+    }
 
-        if (bucket != list_.end()) {
-            auto it = bucket;
-            for (; it != list_.end() && hashPresentID == gethash(it) % buckets_; ++it) {
-                if (getpair(it).first == key) {
-                    if (it == bucket) {
-                        auto next = std::next(it);
-                        if (next != list_.end() && gethash(next) % buckets_ == hashPresentID) {
-                            bucket = next;
-                        } else {
-                            bucket = list_.end();
-                        }
-                    }
-                    list_.erase(it);
-                    --size_;
-                    break;
-                }
+    // Same as for_each, stripes are handed out to nThreads workers; fn must be thread-safe
+    template <typename Func>
+    void parallel_for_each(size_t nThreads, Func&& fn) const {
+        std::atomic<size_t> next{0};
+        auto worker = [this, &next, &fn] {
+            std::vector<Node*> nodes;
+            for (size_t idx = next.fetch_add(1, std::memory_order_relaxed); idx < stripes_.size();
+                 idx = next.fetch_add(1, std::memory_order_relaxed)) {
+                for_each_in_stripe(stripes_[idx], fn, nodes);
             }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(nThreads, stripes_.size()); ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : workers) {
+            thread.join();
         }
     }
 
-    void erase(std::initializer_list<Key> InitList) {
-        for (const auto& key : InitList) {
-            erase(key);
+    // Point-in-time copy of the map. All stripe locks are held only while entry pointers are
+    // gathered; the copies are made afterwards. Integral values bumped by the lock-free
+    // fetch_add are read after the cut and may include later increments.
+    std::vector<std::pair<Key, Val>> snapshot() const {
+        std::vector<Node*> nodes;
+        std::vector<std::pair<Key, Val>> res;
+
+        ebr::Guard guard;
+        for (const auto& stripe : stripes_) {
+            stripe.mut.lock();
+        }
+        for (const auto& stripe : stripes_) {
+            collect_locked(stripe, nodes);
+        }
+        for (auto stripe = stripes_.rbegin(); stripe != stripes_.rend(); ++stripe) {
+            stripe->mut.unlock();
         }
+
+        res.reserve(nodes.size());
+        for (Node* node : nodes) {
+            res.emplace_back(node->key, load_val(node));
+        }
+        return res;
     }
 
-    bool contains(const Key& key) const {
-        size_t hashID = hash_(key) % buckets_;
-        auto it = hash_table_[hashID];
-        if (it != list_.end()) {
-            for (; it != list_.end() && hashID == gethash(it) % buckets_; ++it) {
-                if (getpair(it).first == key) {
-                    return true;
+    // Walks every table, each stripe is locked while it is inspected
+    hash_map_stats stats() const {
+        hash_map_stats res;
+        size_t probes = 0;
+        for (const auto& stripe : stripes_) {
+            std::lock_guard<std::mutex> guard(stripe.mut);
+            res.size += stripe.size;
+            res.rehashes += stripe.resizes.load(std::memory_order_relaxed);
+            res.contended_locks += stripe.contended;
+            res.lock_wait_ns += stripe.lockWaitNs;
+            for (Table* table : {stripe.old.load(std::memory_order_relaxed),
+                                 stripe.table.load(std::memory_order_relaxed)}) {
+                if (table == nullptr) {
+                    continue;
+                }
+                res.capacity += table->mask + 1;
+                for (size_t i = 0; i <= table->mask; ++i) {
+                    const Slot& slot = table->slots[i];
+                    if (!is_entry(slot.node.load(std::memory_order_relaxed))) {
+                        continue;
+                    }
+                    size_t home = home_of(slot.hash.load(std::memory_order_relaxed), table->mask);
+                    size_t dist = (i - home) & table->mask;
+                    probes += dist;
+                    res.max_probe = std::max(res.max_probe, dist);
                 }
             }
         }
-        return false;
+        if (res.capacity != 0) {
+            res.load_factor = static_cast<double>(res.size) / static_cast<double>(res.capacity);
+        }
+        if (res.size != 0) {
+            res.mean_probe = static_cast<double>(probes) / static_cast<double>(res.size);
+        }
+        return res;
     }
 
-    void clear() {
-        lock_all();
+    size_t stripe_count() const {
+        return stripes_.size();
+    }
 
-        list_.clear();
-        hash_table_.resize(INIT_BUCKETS);
-        for (auto& bucket : hash_table_) {
-            bucket = list_.end();
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& stripe : stripes_) {
+            std::lock_guard<std::mutex> guard(stripe.mut);
+            total += stripe.size;
         }
+        return total;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
 
-        unlock_all();
+    double load_factor() const {
+        size_t total = 0;
+        size_t capacity = 0;
+        for (const auto& stripe : stripes_) {
+            std::lock_guard<std::mutex> guard(stripe.mut);
+            total += stripe.size;
+            capacity += stripe.table.load(std::memory_order_relaxed)->mask + 1;
+        }
+        return static_cast<double>(total) / static_cast<double>(capacity);
+    }
+
+    void clear() {
+        for (auto& stripe : stripes_) {
+            std::lock_guard<std::mutex> guard(stripe.mut);
+            if (Table* old = stripe.old.exchange(nullptr, std::memory_order_acq_rel)) {
+                retire_with_entries(old);
+            }
+            Table* table =
+                    stripe.table.exchange(new Table(INIT_BUCKETS), std::memory_order_acq_rel);
+            retire_with_entries(table);
+            stripe.size = 0;
+            stripe.used = 0;
+            stripe.migrated = 0;
+        }
     }
 };
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <lib/maps/blocking_hash_map.hpp>
+
+// Front-end over Shards independent concurrent_hash_map instances.
+//
+// A key is routed to its shard by a Fibonacci hash of the user hash, which is independent of
+// the splitmix scrambling the shard applies internally, so keys of one shard still spread
+// evenly over its stripes and home slots. Shards share nothing: every one has its own stripes,
+// its own resizes and its own counters, which makes shard_stats() a per-partition view of
+// occupancy, probe lengths, resizes and lock contention. Calls are forwarded unchanged, so the
+// interface is the one of concurrent_hash_map, including transparent lookups.
+template <typename Key, typename Val, size_t Shards, typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Alloc = slab_allocator<std::pair<const Key, Val>>>
+class sharded_hash_map {
+    static_assert(Shards > 0, "sharded_hash_map needs at least one shard");
+
+private:
+    using Map = concurrent_hash_map<Key, Val, Hasher, KeyEqual, Alloc>;
+
+    static constexpr size_t STRIPES_PER_CORE = 4;
+
+    std::array<std::unique_ptr<Map>, Shards> shards_;
+    Hasher hash_;
+
+    static size_t default_stripes() {
+        size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+        return std::max<size_t>(1, cores * STRIPES_PER_CORE / Shards);
+    }
+
+    // Multiplies by 2^64 / phi and maps the top 32 bits onto [0, Shards) without a division
+    template <typename K>
+    size_t shard_index(const K& key) const {
+        uint64_t h = static_cast<uint64_t>(hash_(key)) * 0x9e3779b97f4a7c15ULL;
+        return static_cast<size_t>(((h >> 32) * Shards) >> 32);
+    }
+
+    template <typename K>
+    Map& shard_of(const K& key) {
+        return *shards_[shard_index(key)];
+    }
+
+    template <typename K>
+    const Map& shard_of(const K& key) const {
+        return *shards_[shard_index(key)];
+    }
+
+public:
+    // `buckets` is split evenly between the shards, `stripes` is per shard (0 picks a default)
+    explicit sharded_hash_map(size_t buckets = 0, size_t stripes = 0) {
+        for (auto& shard : shards_) {
+            shard = std::make_unique<Map>(buckets / Shards,
+                                          stripes == 0 ? default_stripes() : stripes);
+        }
+    }
+
+    sharded_hash_map(std::initializer_list<std::pair<Key, Val>> InitList): sharded_hash_map() {
+        for (const auto& item : InitList) {
+            insert(item);
+        }
+    }
+
+    sharded_hash_map(const sharded_hash_map&) = delete;
+    sharded_hash_map& operator=(const sharded_hash_map&) = delete;
+
+    bool insert(const std::pair<Key, Val>& item) {
+        return shard_of(item.first).insert(item);
+    }
+
+    bool insert(std::pair<Key, Val>&& item) {
+        Map& shard = shard_of(item.first);
+        return shard.insert(std::move(item));
+    }
+
+    template <typename K, typename... Args>
+    bool emplace(K&& key, Args&&... args) {
+        Map& shard = shard_of(key);
+        return shard.emplace(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool try_emplace(const Key& key, Args&&... args) {
+        return shard_of(key).try_emplace(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool try_emplace(Key&& key, Args&&... args) {
+        Map& shard = shard_of(key);
+        return shard.try_emplace(std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <typename M>
+    bool insert_or_assign(const Key& key, M&& val) {
+        return shard_of(key).insert_or_assign(key, std::forward<M>(val));
+    }
+
+    template <typename M>
+    bool insert_or_assign(Key&& key, M&& val) {
+        Map& shard = shard_of(key);
+        return shard.insert_or_assign(std::move(key), std::forward<M>(val));
+    }
+
+    template <typename Func>
+    bool upsert(const Key& key, Func&& fn) {
+        return shard_of(key).upsert(key, std::forward<Func>(fn));
+    }
+
+    template <typename Func>
+    bool compute_if_present(const Key& key, Func&& fn) {
+        return shard_of(key).compute_if_present(key, std::forward<Func>(fn));
+    }
+
+    template <typename Func>
+    bool compute_if_absent(const Key& key, Func&& fn) {
+        return shard_of(key).compute_if_absent(key, std::forward<Func>(fn));
+    }
+
+    Val fetch_add(const Key& key, Val delta)
+        requires(std::is_integral_v<Val> && !std::is_same_v<Val, bool>)
+    {
+        return shard_of(key).fetch_add(key, delta);
+    }
+
+    template <typename K>
+    bool erase(const K& key) {
+        return shard_of(key).erase(key);
+    }
+
+    template <typename K>
+    bool contains(const K& key) const {
+        return shard_of(key).contains(key);
+    }
+
+    template <typename K>
+    std::optional<Val> find(const K& key) const {
+        return shard_of(key).find(key);
+    }
+
+    template <typename K>
+    Val get_or(const K& key, const Val& defaultVal) const {
+        return shard_of(key).get_or(key, defaultVal);
+    }
+
+    template <typename K, typename Func>
+    bool visit(const K& key, Func&& fn) const {
+        return shard_of(key).visit(key, std::forward<Func>(fn));
+    }
+
+    // Consistent per stripe of every shard, see concurrent_hash_map::for_each
+    template <typename Func>
+    void for_each(Func&& fn) const {
+        for (const auto& shard : shards_) {
+            shard->for_each(fn);
+        }
+    }
+
+    static constexpr size_t shard_count() {
+        return Shards;
+    }
+
+    hash_map_stats shard_stats(size_t shard) const {
+        return shards_[shard]->stats();
+    }
+
+    // Totals over all shards; probe lengths are weighted by shard size
+    hash_map_stats stats() const {
+        hash_map_stats res;
+        double probes = 0;
+        for (const auto& shard : shards_) {
+            hash_map_stats cur = shard->stats();
+            res.size += cur.size;
+            res.capacity += cur.capacity;
+            res.max_probe = std::max(res.max_probe, cur.max_probe);
+            res.rehashes += cur.rehashes;
+            res.contended_locks += cur.contended_locks;
+            res.lock_wait_ns += cur.lock_wait_ns;
+            probes += cur.mean_probe * static_cast<double>(cur.size);
+        }
+        if (res.capacity != 0) {
+            res.load_factor = static_cast<double>(res.size) / static_cast<double>(res.capacity);
+        }
+        if (res.size != 0) {
+            res.mean_probe = probes / static_cast<double>(res.size);
+        }
+        return res;
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard->size();
+        }
+        return total;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            shard->clear();
+        }
+    }
+};
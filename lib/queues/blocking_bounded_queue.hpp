@@ -1,93 +1,117 @@
 #pragma once
 
-#include <lib/common/task.hpp>
-
-// lock-based bounded queue. One buffer implementation
+#include <lib/queues/lockfree_bounded_queue.hpp>
+
+// Blocking bounded queue on top of the lock-free ring.
+//
+// Producers and consumers never take a lock: they go through mpmc_bounded_queue and only when
+// it is full (producers) or empty (consumers) back off and finally sleep in a futex::WaitQueue,
+// one for each side. Every side counts its sleepers, and the other side makes a wake syscall
+// only when that count is non-zero, so a queue that is neither full nor empty runs without any
+// syscall. dequeue blocks while the queue is empty until wakeUp() is called, after which it
+// drains what is left and then returns false. The size is rounded up to a power of two.
 template <typename TaskT>
 class BlockingBoundedQueue {
 private:
-    uint64_t size_{};
-
-    mutable std::mutex mut_;
-    std::condition_variable condProd_;
-    std::condition_variable condCons_;
+    // parking is done here, the ring only has to never park on its own
+    mpmc_bounded_queue<TaskT, RingLayout::Packed, backoff::Spin> ring_;
 
-    std::vector<TaskT> buffer_;
+    // producers waiting for room, consumers waiting for items
+    alignas(CACHE_LINE) futex::WaitQueue notFull_;
+    alignas(CACHE_LINE) futex::WaitQueue notEmpty_;
 
-    uint64_t dequeuePos_{};
-    uint64_t enqueuePos_{};
+    std::atomic<bool> done_{false};
 
-    bool full_ = false;
-    bool empty_ = true;
-    bool done_ = false;
+    void waitNotFull(backoff::Park& backoff) {
+        if (!backoff.Pause()) {
+            notFull_.Park([this] {
+                return ring_.full();
+            });
+        }
+    }
 
-    // 34****12
-    //  |    |
-    //  b    f
+    // false once the queue is empty and woken up for good
+    bool waitNotEmpty(backoff::Park& backoff) {
+        if (done_.load(std::memory_order_acquire)) {
+            return !ring_.empty();
+        }
+        if (!backoff.Pause()) {
+            notEmpty_.Park([this] {
+                return ring_.empty() && !done_.load(std::memory_order_relaxed);
+            });
+        }
+        return true;
+    }
 
 public:
     BlockingBoundedQueue(): BlockingBoundedQueue(32){};
-    BlockingBoundedQueue(uint64_t size): buffer_(size) {
+    BlockingBoundedQueue(uint64_t size): ring_(size) {
     }
 
-    // Some producer sends the data to the queue
-    // Then condProd_ waits while buffer is full or skips waiting if it's not full
-    // Then it pushes data to the end of the queue (if enqueuePos_ overtakes frontIdx then the queue
-    // is full)
-    void enqueue(TaskT&& task) {
-        std::unique_lock<std::mutex> guard{mut_};
-
-        condProd_.wait(guard, [this] {
-            return !full_;
-        });
-
-        buffer_[enqueuePos_] = std::move(task);
-        enqueuePos_ = (enqueuePos_ + 1) % buffer_.size();
+    BlockingBoundedQueue(const BlockingBoundedQueue&) = delete;
+    BlockingBoundedQueue& operator=(const BlockingBoundedQueue&) = delete;
 
-        size_++;
-        if (size_ == buffer_.size()) {
-            full_ = true;
+    // Blocks while the queue is full
+    void enqueue(TaskT&& task) {
+        backoff::Park backoff;
+        while (!ring_.tryEnqueue(std::move(task))) {
+            waitNotFull(backoff);
         }
-        empty_ = false;
-
-        guard.unlock();
-        condCons_.notify_one();
+        notEmpty_.Wake(1);
     }
 
+    // Blocks while the queue is empty, returns false only after wakeUp()
     bool dequeue(TaskT& task) {
-        std::unique_lock<std::mutex> guard{mut_};
-
-        condCons_.wait(guard, [this] {
-            return !empty_ || done_;
-        });
-
-        if (empty_) {
-            return false;
+        backoff::Park backoff;
+        while (!ring_.dequeue(task)) {
+            if (!waitNotEmpty(backoff)) {
+                return false;
+            }
         }
+        notFull_.Wake(1);
+        return true;
+    }
 
-        task = std::move(buffer_[dequeuePos_]);
-        dequeuePos_ = (dequeuePos_ + 1) % buffer_.size();
+    // Moves in as many tasks as there is room for per reservation, wakes consumers once each
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        backoff::Park backoff;
+        while (first != last) {
+            uint64_t added = ring_.tryEnqueueBulk(first, last);
+            if (added == 0) {
+                waitNotFull(backoff);
+                continue;
+            }
+            std::advance(first, added);
+            notEmpty_.Wake(added);
+        }
+    }
 
-        size_--;
-        if (size_ == 0) {
-            empty_ = true;
+    // Takes up to max tasks, blocks like dequeue while the queue is empty
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        if (max == 0) {
+            return 0;
         }
-        full_ = false;
 
-        guard.unlock();
-        condProd_.notify_one();
-        return true;
+        backoff::Park backoff;
+        size_t taken;
+        while ((taken = ring_.dequeueBulk(out, max)) == 0) {
+            if (!waitNotEmpty(backoff)) {
+                return 0;
+            }
+        }
+        notFull_.Wake(taken);
+        return taken;
     }
 
+    // Releases blocked consumers once the queue runs empty
     void wakeUp() {
-        std::unique_lock<std::mutex> guard{mut_};
-        done_ = true;
-        guard.unlock();
-        condCons_.notify_all();
+        done_.store(true, std::memory_order_release);
+        notEmpty_.WakeAll();
     }
 
     bool empty() const {
-        std::unique_lock<std::mutex> guard{mut_};
-        return empty_ && done_;
+        return ring_.empty() && done_.load(std::memory_order_acquire);
     }
 };
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <lib/common/common.h>
+
+// Arity that makes a group of siblings fill one cache line, kept within [2, 8]
+template <typename ValT>
+constexpr size_t defaultHeapArity() {
+    return std::clamp<size_t>(CACHE_LINE / sizeof(ValT), 2, 8);
+}
+
+// d-ary heap with cache-line aligned sibling groups, a drop-in for BinHeap.
+//
+// With CmpT = std::less<> the largest value is on top, as in BinHeap. The tree is d times
+// flatter than a binary heap, and sift_down reads all children of a node from one cache line:
+// the storage is cache-line aligned and the root is preceded by Arity - 1 unused slots, so the
+// children of every node start on a line boundary when Arity * sizeof(ValT) == CACHE_LINE.
+// Sifting moves values into a hole instead of swapping, and top/pop/emplace never copy. The
+// padding slots are default-constructed, so ValT must be default-constructible.
+// h_bottom() and h_erase_bottom() still scan the leaves; MinMaxHeap has them in O(log n).
+template <typename ValT, size_t Arity = defaultHeapArity<ValT>(), typename CmpT = std::less<>>
+class DaryHeap {
+    static_assert(Arity >= 2, "a heap needs at least two children per node");
+
+private:
+    static constexpr size_t PAD = Arity - 1;
+
+    // element i lives in array_[PAD + i]
+    std::vector<ValT, cache_aligned_allocator<ValT>> array_;
+    CmpT cmp_;
+
+    ValT& at(size_t i) {
+        return array_[PAD + i];
+    }
+
+    const ValT& at(size_t i) const {
+        return array_[PAD + i];
+    }
+
+    static size_t parent(size_t i) {
+        return (i - 1) / Arity;
+    }
+
+    static size_t firstChild(size_t i) {
+        return Arity * i + 1;
+    }
+
+    void sift_up(size_t i) {
+        ValT val = std::move(at(i));
+        while (i > 0) {
+            size_t p = parent(i);
+            if (!cmp_(at(p), val)) {
+                break;
+            }
+            at(i) = std::move(at(p));
+            i = p;
+        }
+        at(i) = std::move(val);
+    }
+
+    void sift_down(size_t i) {
+        size_t n = size();
+        ValT val = std::move(at(i));
+        while (true) {
+            size_t first = firstChild(i);
+            if (first >= n) {
+                break;
+            }
+            size_t last = std::min(first + Arity, n);
+
+            size_t best = first;
+            for (size_t c = first + 1; c < last; ++c) {
+                if (cmp_(at(best), at(c))) {
+                    best = c;
+                }
+            }
+            if (!cmp_(val, at(best))) {
+                break;
+            }
+            if (firstChild(best) < n) {
+                prefetch(&at(firstChild(best)));
+            }
+            at(i) = std::move(at(best));
+            i = best;
+        }
+        at(i) = std::move(val);
+    }
+
+    // Index of the lowest value, always among the leaves
+    size_t bottom_index() const {
+        size_t n = size();
+        size_t best = n == 1 ? 0 : parent(n - 1) + 1;
+        for (size_t i = best + 1; i < n; ++i) {
+            if (cmp_(at(i), at(best))) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+public:
+    DaryHeap(): array_(PAD) {
+    }
+
+    template <typename RanIt>
+    DaryHeap(RanIt begin, RanIt end): array_(PAD) {
+        array_.insert(array_.end(), begin, end);
+        if (size() > 1) {
+            for (size_t i = parent(size() - 1) + 1; i-- > 0;) {
+                sift_down(i);
+            }
+        }
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        array_.emplace_back(std::forward<Args>(args)...);
+        sift_up(size() - 1);
+    }
+
+    void h_insert(const ValT& val) {
+        emplace(val);
+    }
+
+    void h_insert(ValT&& val) {
+        emplace(std::move(val));
+    }
+
+    // Moves the top out
+    ValT pop() {
+        assert(size() > 0);
+        ValT top = std::move(at(0));
+        h_erase_by_index(0);
+        return top;
+    }
+
+    ValT h_pop_top() {
+        return pop();
+    }
+
+    void h_erase_by_index(size_t index) {
+        assert(index < size());
+        size_t last = size() - 1;
+        if (index != last) {
+            at(index) = std::move(at(last));
+        }
+        array_.pop_back();
+        if (index < size()) {
+            sift_down(index);
+            sift_up(index);
+        }
+    }
+
+    void h_erase_by_value(const ValT& val) {
+        auto it = std::find(array_.begin() + PAD, array_.end(), val);
+        if (it != array_.end()) {
+            h_erase_by_index(static_cast<size_t>(std::distance(array_.begin() + PAD, it)));
+        }
+    }
+
+    void h_erase_top() {
+        h_erase_by_index(0);
+    }
+
+    void h_erase_bottom() {
+        h_erase_by_index(bottom_index());
+    }
+
+    const ValT& h_top() const {
+        assert(size() > 0);
+        return at(0);
+    }
+
+    const ValT& h_peek_top() const {
+        return h_top();
+    }
+
+    const ValT& h_bottom() const {
+        assert(size() > 0);
+        return at(bottom_index());
+    }
+
+    void h_print() const {
+        for (size_t i = 0; i < size(); ++i) {
+            std::cout << at(i) << ' ';
+        }
+        std::cout << std::endl;
+    }
+
+    size_t size() const {
+        return array_.size() - PAD;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+};
@@ -1,31 +1,128 @@
 #pragma once
 
 #include <lib/common/task.hpp>
+#include <lib/common/backoff.h>
+#include <lib/common/futex.h>
 
-template <typename T>
+// How the cells of a bounded ring are laid out in memory.
+//
+// Neighbouring positions are claimed by different threads at nearly the same time. With
+// Packed cells several of them share a cache line, so every claim invalidates the line for the
+// threads working on the next cells. PaddedCells gives every cell a line of its own at the
+// price of memory; Scrambled keeps the packed array but maps consecutive positions to
+// consecutive lines, so a line is revisited only once per round of lines.
+enum class RingLayout { Packed, PaddedCells, Scrambled };
+
+// Vyukov's bounded MPMC ring. The size is rounded up to a power of two. The producer and
+// consumer positions live on cache lines of their own in every layout.
+//
+// A producer that finds the ring full waits according to Backoff (see backoff.h). Once the
+// policy gives up the producer parks in producers_ (futex::WaitQueue). Consumers enter the
+// kernel only if a producer sleeps there, so while nobody sleeps the consumer side pays one
+// fence per operation and no syscall.
+template <typename TaskT, RingLayout Layout = RingLayout::Packed,
+          typename Backoff = backoff::Park>
 class mpmc_bounded_queue {
 private:
-    struct Cell {
+    struct PackedCell {
+        std::atomic<uint64_t> sequence;
+        TaskT task;
+    };
+
+    struct alignas(CACHE_LINE) PaddedCell {
         std::atomic<uint64_t> sequence;
         TaskT task;
     };
 
+    using Cell = std::conditional_t<Layout == RingLayout::PaddedCells, PaddedCell, PackedCell>;
+
+    static constexpr uint64_t CELLS_PER_LINE =
+            sizeof(Cell) < CACHE_LINE && CACHE_LINE % sizeof(Cell) == 0 ? CACHE_LINE / sizeof(Cell)
+                                                                        : 1;
+
     std::vector<Cell> buffer_;
     uint64_t bufMask_;
-    std::atomic<uint64_t> enqueuePos_;
-    std::atomic<uint64_t> dequeuePos_;
+    // Scrambled only: the ring is a lines x CELLS_PER_LINE matrix read column by column
+    uint64_t linesMask_ = 0;
+    uint64_t linesShift_ = 0;
+    uint64_t cellShift_ = 0;
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> enqueuePos_;
+    alignas(CACHE_LINE) std::atomic<uint64_t> dequeuePos_;
+
+    // producers sleeping on a full ring
+    alignas(CACHE_LINE) futex::WaitQueue producers_;
+
+    Cell& cellAt(uint64_t pos) {
+        uint64_t idx = pos & bufMask_;
+        if constexpr (Layout == RingLayout::Scrambled) {
+            idx = ((idx & linesMask_) << cellShift_) | (idx >> linesShift_);
+        }
+        return buffer_[idx];
+    }
+
+    // Sleeps until a consumer frees a cell or the timeout passes
+    void park(std::chrono::nanoseconds timeout) {
+        producers_.Park([this] {
+            return full();
+        }, timeout);
+    }
+
+    // Called after freeing `cells` cells
+    void wakeProducers(uint64_t cells) {
+        if constexpr (!Backoff::PARKS) {
+            return;
+        }
+        producers_.Wake(cells);
+    }
+
+    // Enqueues with backoff, gives up at the deadline unless there is none
+    bool enqueueUntil(TaskT&& task, std::optional<std::chrono::steady_clock::time_point> deadline) {
+        Backoff backoff;
+        while (!tryEnqueue(std::move(task))) {
+            auto timeout = futex::FOREVER;
+            if (deadline) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= *deadline) {
+                    return false;
+                }
+                timeout = *deadline - now;
+            }
+            if (!backoff.Pause()) {
+                park(timeout);
+            }
+        }
+        return true;
+    }
 
 public:
-    LockfreeBoundedQueue(uint64_t size = 128): buffer_(size), bufMask_(size - 1) {
-        for (uint64_t i = 0; i < size; i++) {
-            buffer_[i].sequence.store(i, std::memory_order_relaxed);
+    mpmc_bounded_queue(uint64_t size = 128)
+        : buffer_(std::bit_ceil(std::max<uint64_t>(size, 2))), bufMask_(buffer_.size() - 1) {
+        if constexpr (Layout == RingLayout::Scrambled) {
+            // a ring smaller than one line of lines has nothing to spread
+            if (buffer_.size() >= CELLS_PER_LINE * CELLS_PER_LINE) {
+                uint64_t lines = buffer_.size() / CELLS_PER_LINE;
+                linesMask_ = lines - 1;
+                linesShift_ = static_cast<uint64_t>(std::countr_zero(lines));
+                cellShift_ = static_cast<uint64_t>(std::countr_zero(CELLS_PER_LINE));
+            } else {
+                linesMask_ = bufMask_;
+            }
+        }
+
+        for (uint64_t i = 0; i < buffer_.size(); i++) {
+            cellAt(i).sequence.store(i, std::memory_order_relaxed);
         }
 
         enqueuePos_.store(0, std::memory_order_relaxed);
         dequeuePos_.store(0, std::memory_order_relaxed);
     }
 
-    void enqueue(TaskT&& task) {
+    mpmc_bounded_queue(const mpmc_bounded_queue&) = delete;
+    mpmc_bounded_queue& operator=(const mpmc_bounded_queue&) = delete;
+
+    // Fails only if the ring is full; the task is left untouched then
+    bool tryEnqueue(TaskT&& task) {
         Cell* cell;
         uint64_t pos;
         bool res = false;
@@ -33,14 +130,13 @@ public:
         while (!res) {
             // fetch the current Position where to enqueue the item
             pos = enqueuePos_.load(std::memory_order_relaxed);
-            cell = &buffer_[pos & bufMask_];
+            cell = &cellAt(pos);
             auto seq = cell->sequence.load(std::memory_order_acquire);
-            auto diff = static_cast<int>(seq) - static_cast<int>(pos);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
 
-            // queue is full we cannot enqueue and just continue
-            // another option: queue moved forward all way round
+            // queue is full: the cell still holds an item of the previous round
             if (diff < 0) {
-                continue;
+                return false;
             }
 
             // If its Sequence wasn't touched by other producers
@@ -53,6 +149,20 @@ public:
         // write the item we want to enqueue and bump Sequence
         cell->task = std::move(task);
         cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Waits for room as long as it takes
+    void enqueue(TaskT&& task) {
+        enqueueUntil(std::move(task), std::nullopt);
+    }
+
+    // Waits for room at most `timeout`; on failure the task is left untouched
+    template <typename Rep, typename Period>
+    bool enqueueFor(TaskT&& task, const std::chrono::duration<Rep, Period>& timeout) {
+        return enqueueUntil(std::move(task), std::chrono::steady_clock::now() +
+                                                     std::chrono::ceil<std::chrono::nanoseconds>(
+                                                             timeout));
     }
 
     bool dequeue(TaskT& task) {
@@ -63,9 +173,9 @@ public:
         while (!res) {
             // fetch the current Position from where we can dequeue an item
             pos = dequeuePos_.load(std::memory_order_relaxed);
-            cell = &buffer_[pos & bufMask_];
+            cell = &cellAt(pos);
             auto seq = cell->sequence.load(std::memory_order_acquire);
-            auto diff = static_cast<int>(seq) - static_cast<int>(pos + 1);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
 
             // probably the queue is empty, then return false
             if (diff < 0) {
@@ -82,10 +192,114 @@ public:
         // read the item and update for the next round of the buffer
         task = std::move(cell->task);
         cell->sequence.store(pos + bufMask_ + 1, std::memory_order_release);
+        wakeProducers(1);
         return true;
     }
 
+    // Moves in the longest prefix of first..last that fits, reserved with a single CAS on
+    // enqueuePos_. Returns how many tasks went in, 0 only if the ring is full.
+    template <typename Iter>
+    uint64_t tryEnqueueBulk(Iter first, Iter last) {
+        auto left = static_cast<uint64_t>(std::distance(first, last));
+        if (left == 0) {
+            return 0;
+        }
+
+        while (true) {
+            uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+
+            // a cell is free for position p once its sequence has come round to p
+            uint64_t count = 0;
+            while (count < left && count <= bufMask_ &&
+                   cellAt(pos + count).sequence.load(std::memory_order_acquire) == pos + count) {
+                ++count;
+            }
+
+            if (count == 0) {
+                // queue is full, unless another producer got ahead of us
+                if (pos == enqueuePos_.load(std::memory_order_relaxed)) {
+                    return 0;
+                }
+                continue;
+            }
+            if (!enqueuePos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                continue;
+            }
+
+            for (uint64_t i = 0; i < count; ++i, ++first) {
+                Cell& cell = cellAt(pos + i);
+                cell.task = std::move(*first);
+                cell.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+            return count;
+        }
+    }
+
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        Backoff backoff;
+        while (first != last) {
+            uint64_t count = tryEnqueueBulk(first, last);
+            if (count == 0) {
+                if (!backoff.Pause()) {
+                    park(futex::FOREVER);
+                }
+                continue;
+            }
+            std::advance(first, count);
+        }
+    }
+
+    // Reserves a run of consecutive filled cells with a single CAS on dequeuePos_
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        if (max == 0) {
+            return 0;
+        }
+
+        uint64_t pos;
+        uint64_t count;
+
+        while (true) {
+            pos = dequeuePos_.load(std::memory_order_relaxed);
+
+            count = 0;
+            while (count < max && count <= bufMask_ &&
+                   cellAt(pos + count).sequence.load(std::memory_order_acquire) ==
+                           pos + count + 1) {
+                ++count;
+            }
+
+            if (count == 0) {
+                auto seq = cellAt(pos).sequence.load(std::memory_order_acquire);
+                if (static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1) < 0) {
+                    return 0;
+                }
+                continue;
+            }
+
+            if (dequeuePos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (uint64_t i = 0; i < count; ++i) {
+            Cell& cell = cellAt(pos + i);
+            *out++ = std::move(cell.task);
+            cell.sequence.store(pos + i + bufMask_ + 1, std::memory_order_release);
+        }
+        wakeProducers(count);
+        return count;
+    }
+
     bool empty() const {
         return enqueuePos_.load() == dequeuePos_.load();
     }
+
+    // The next cell to fill still holds an item of the previous round
+    bool full() {
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        auto seq = cellAt(pos).sequence.load(std::memory_order_acquire);
+        return static_cast<int64_t>(seq) - static_cast<int64_t>(pos) < 0;
+    }
 };
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <lib/queues/uniQueue.hpp>
+
+// lock-free unbounded queue. Michael-Scott list with hazard pointers, see uniQueue.hpp
+template <typename TaskT>
+using LockfreeUnboundedQueue = uniQueue<TaskT, LIST | UNBOUNDED | LOCKFREE | NOTPRIOR>;
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <lib/common/common.h>
+
+// Min-max heap (Atkinson et al.), a drop-in for BinHeap with a cheap bottom.
+//
+// With CmpT = std::less<> the largest value is on top, as in BinHeap. Levels alternate: a node
+// on an even level (the root's) is not below any of its descendants, a node on an odd level is
+// not above any of them. The top is the root, the bottom is the lower of the root's children,
+// so h_top()/h_bottom() are O(1) and removing either end is O(log n) - BinHeap scans half the
+// array for the bottom. All operations move values, nothing is copied.
+template <typename ValT, typename CmpT = std::less<>>
+class MinMaxHeap {
+private:
+    std::vector<ValT> array_;
+    CmpT cmp_;
+
+    static size_t parent(size_t i) {
+        return (i - 1) / 2;
+    }
+
+    static bool top_level(size_t i) {
+        return std::bit_width(i + 1) % 2 == 1;
+    }
+
+    // lhs lies further towards the top (top levels) or the bottom (bottom levels) than rhs
+    bool beyond(const ValT& lhs, const ValT& rhs, bool top) const {
+        return top ? cmp_(rhs, lhs) : cmp_(lhs, rhs);
+    }
+
+    void bubble_up_grand(size_t i, bool top) {
+        while (i > 2) {
+            size_t grand = parent(parent(i));
+            if (!beyond(array_[i], array_[grand], top)) {
+                break;
+            }
+            std::swap(array_[i], array_[grand]);
+            i = grand;
+        }
+    }
+
+    void bubble_up(size_t i) {
+        if (i == 0) {
+            return;
+        }
+        bool top = top_level(i);
+        size_t p = parent(i);
+        // the parent sits on the other kind of level
+        if (beyond(array_[i], array_[p], !top)) {
+            std::swap(array_[i], array_[p]);
+            bubble_up_grand(p, !top);
+        } else {
+            bubble_up_grand(i, top);
+        }
+    }
+
+    void trickle_down(size_t i) {
+        bool top = top_level(i);
+        size_t n = array_.size();
+        while (2 * i + 1 < n) {
+            // the extreme one among children and grandchildren
+            size_t best = 2 * i + 1;
+            size_t candidates[] = {2 * i + 2, 4 * i + 3, 4 * i + 4, 4 * i + 5, 4 * i + 6};
+            for (size_t c : candidates) {
+                if (c < n && beyond(array_[c], array_[best], top)) {
+                    best = c;
+                }
+            }
+
+            if (!beyond(array_[best], array_[i], top)) {
+                return;
+            }
+            std::swap(array_[best], array_[i]);
+            if (best <= 2 * i + 2) {
+                // a child is on the other kind of level and has no grandchildren to care about
+                return;
+            }
+            size_t p = parent(best);
+            if (beyond(array_[p], array_[best], top)) {
+                std::swap(array_[p], array_[best]);
+            }
+            i = best;
+        }
+    }
+
+    size_t bottom_index() const {
+        if (array_.size() <= 2) {
+            return array_.size() - 1;
+        }
+        return cmp_(array_[2], array_[1]) ? 2 : 1;
+    }
+
+    void erase_at(size_t index) {
+        size_t last = array_.size() - 1;
+        if (index != last) {
+            array_[index] = std::move(array_[last]);
+        }
+        array_.pop_back();
+        if (index < array_.size()) {
+            trickle_down(index);
+        }
+    }
+
+public:
+    MinMaxHeap() {
+    }
+
+    template <typename RanIt>
+    MinMaxHeap(RanIt begin, RanIt end) {
+        array_.reserve(static_cast<size_t>(std::distance(begin, end)));
+        for (; begin != end; ++begin) {
+            emplace(*begin);
+        }
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        array_.emplace_back(std::forward<Args>(args)...);
+        bubble_up(array_.size() - 1);
+    }
+
+    void h_insert(const ValT& val) {
+        emplace(val);
+    }
+
+    void h_insert(ValT&& val) {
+        emplace(std::move(val));
+    }
+
+    // Moves the top out
+    ValT pop() {
+        assert(array_.size() > 0);
+        ValT top = std::move(array_[0]);
+        erase_at(0);
+        return top;
+    }
+
+    // Moves the bottom out
+    ValT pop_bottom() {
+        assert(array_.size() > 0);
+        size_t index = bottom_index();
+        ValT bottom = std::move(array_[index]);
+        erase_at(index);
+        return bottom;
+    }
+
+    ValT h_pop_top() {
+        return pop();
+    }
+
+    void h_erase_top() {
+        assert(array_.size() > 0);
+        erase_at(0);
+    }
+
+    void h_erase_bottom() {
+        assert(array_.size() > 0);
+        erase_at(bottom_index());
+    }
+
+    const ValT& h_top() const {
+        assert(array_.size() > 0);
+        return array_[0];
+    }
+
+    const ValT& h_peek_top() const {
+        return h_top();
+    }
+
+    const ValT& h_bottom() const {
+        assert(array_.size() > 0);
+        return array_[bottom_index()];
+    }
+
+    void h_print() const {
+        for (auto& el : array_) {
+            std::cout << el << ' ';
+        }
+        std::cout << std::endl;
+    }
+
+    size_t size() const {
+        return array_.size();
+    }
+
+    bool empty() const {
+        return array_.empty();
+    }
+};
@@ -3,7 +3,11 @@
 #pragma once
 
 #include <lib/common/task.hpp>
-#include <lib/common/hazard.h>
+#include <lib/common/reclaim.h>
+#include <lib/common/slab_allocator.h>
+#include <lib/queues/lockfree_bounded_queue.hpp>
+#include <lib/queues/blocking_bounded_queue.hpp>
+#include <lib/queues/waitfree_unbounded_queue.hpp>
 
 enum class Base { Array = 0, List = 1 };
 
@@ -11,7 +15,13 @@ enum class Bounded { Yes = 2, No = 3 };
 
 enum class Priority { Yes = 4, No = 5 };
 
-enum class Contention { Lockfree = 6, Blocking = 7 };
+enum class Contention { Lockfree = 6, Blocking = 7, Waitfree = 8 };
+
+enum class Producers { Single = 9, Multi = 10 };
+
+enum class Consumers { Single = 11, Multi = 12 };
+
+enum class Layout { Packed = 13, PaddedCells = 14, Scrambled = 15 };
 
 constexpr uint64_t ARRAY = 1;
 constexpr uint64_t LIST = 2;
@@ -21,24 +31,28 @@ constexpr uint64_t PRIOR = 16;
 constexpr uint64_t NOTPRIOR = 32;
 constexpr uint64_t LOCKFREE = 64;
 constexpr uint64_t BLOCKING = 128;
+constexpr uint64_t WAITFREE = 256;
+constexpr uint64_t SINGLEPROD = 512;
+constexpr uint64_t MULTIPROD = 1024;
+constexpr uint64_t SINGLECONS = 2048;
+constexpr uint64_t MULTICONS = 4096;
+constexpr uint64_t PACKED = 8192;
+constexpr uint64_t PADDEDCELLS = 16384;
+constexpr uint64_t SCRAMBLED = 32768;
 
 // IMPLEMENTED:
-// list lockfree unbounded
+// list lockfree unbounded (hazard pointer, epoch or quiescent-state reclamation)
 // array blocking bounded
-// array lock-free bounded
-// array blocking bounded priority
+// array lock-free bounded (packed, padded or scrambled cells)
+// array lock-free unbounded (segmented)
+// list wait-free unbounded
+// array blocking unbounded priority (relaxed)
+// array lock-free bounded single-producer single-consumer
+// array lock-free bounded single-producer
+// list lock-free unbounded single-consumer
 
 namespace {
 
-namespace smr {
-
-static std::array<hp::ThreadLocalHazardManager*, 
-    THREADS_COUNT> globalMaster;
-thread_local hp::ThreadLocalHazardManager 
-    myMaster(globalMaster);
-
-} // smr
-
 namespace inner {
 
 template <typename T, T Begin, class Func, T... Is>
@@ -106,11 +120,27 @@ struct isBlocking {
     enum { value = static_cast<bool>((1 << static_cast<uint64_t>(Contention::Blocking)) & Mask) };
 };
 
+template <uint64_t Mask>
+struct isWaitFree {
+    enum { value = static_cast<bool>((1 << static_cast<uint64_t>(Contention::Waitfree)) & Mask) };
+};
+
+template <uint64_t Mask>
+struct isSingleProducer {
+    enum { value = static_cast<bool>((1 << static_cast<uint64_t>(Producers::Single)) & Mask) };
+};
+
+template <uint64_t Mask>
+struct isSingleConsumer {
+    enum { value = static_cast<bool>((1 << static_cast<uint64_t>(Consumers::Single)) & Mask) };
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 } // namespace
 
-//! Base::List, Bounded::No, Priority::No, Contention::Lockfree
+//! Base::List, Bounded::No, Priority::No, Contention::Lockfree, Producers::Multi, Consumers::Multi,
+//! Layout::Packed
 template <typename... Args>
 constexpr uint64_t uniQSpec(Args&&... args) noexcept {
     auto tuple = std::make_tuple(std::forward<Args>(args)...);
@@ -121,15 +151,27 @@ constexpr uint64_t uniQSpec(Args&&... args) noexcept {
         mask |= (1 << static_cast<uint64_t>(std::get<i>(tuple)));
     });
 
-    return mask;
+    // many producers and consumers and packed storage is what every queue supports, so asking
+    // for them explicitly selects the same specialization as not asking at all
+    return mask & ~(MULTIPROD | MULTICONS | PACKED);
 }
 
-template <typename TaskT, uint64_t SpecMask>
+// Reclaim picks the memory reclamation policy (see reclaim.h) of queues that free nodes,
+// NodeAlloc where the MS queue gets its nodes from (slab::Pool, or slab::Heap for comparison)
+template <typename TaskT, uint64_t SpecMask, typename Reclaim = reclaim::HazardPointers,
+          template <size_t, size_t> class NodeAlloc = slab::Pool>
 class uniQueue {};
 
 // Classic Michael-Scott Queue
-template <typename TaskT>
-class uniQueue<TaskT, LIST | UNBOUNDED | LOCKFREE | NOTPRIOR> {
+//
+// Nodes are recycled instead of going back to malloc: they come from a per-thread slab pool and
+// the reclamation policy hands retired nodes back to the pool of the thread that frees them.
+// The policy keeps a node out of the pool while anyone can still read it, so reuse brings no
+// ABA. Producers and consumers exchange nodes in batches through the pool's depot. With
+// reclaim::QuiescentState every thread using the queue has to call Reclaim::Quiescent()
+// between operations now and then.
+template <typename TaskT, typename Reclaim, template <size_t, size_t> class NodeAlloc>
+class uniQueue<TaskT, LIST | UNBOUNDED | LOCKFREE | NOTPRIOR, Reclaim, NodeAlloc> {
 private:
     struct Node {
         std::atomic<Node*> next = nullptr;
@@ -139,9 +181,27 @@ private:
         Node(TaskT&& task) : task(std::move(task)) {}
     };
 
+    using NodePool = NodeAlloc<sizeof(Node), alignof(Node)>;
+
     std::atomic<Node*> head_;
     std::atomic<Node*> tail_;
 
+    template <typename... Args>
+    static Node* createNode(Args&&... args) {
+        void* mem = NodePool::Allocate();
+        try {
+            return new (mem) Node(std::forward<Args>(args)...);
+        } catch (...) {
+            NodePool::Deallocate(mem);
+            throw;
+        }
+    }
+
+    static void destroyNode(void* ptr) {
+        static_cast<Node*>(ptr)->~Node();
+        NodePool::Deallocate(ptr);
+    }
+
 // Пример неправильного написания lock-free на C++ ////////////////////////////
 /*
     void ABAenqueue(TaskT&& task) {
@@ -162,7 +222,7 @@ private:
 
 public:
     uniQueue() {
-        Node* sentinel = new Node;
+        Node* sentinel = createNode();
         head_.store(sentinel, std::memory_order_release);
         tail_.store(sentinel, std::memory_order_release);
     }
@@ -170,21 +230,30 @@ public:
     ~uniQueue() {
         // Деструктор вызывается главным потоком
         Node* cur = head_;
-        do {
+        while (cur != nullptr) {
             Node* toDel = cur;
             cur = cur->next;
-            delete toDel;
-        } while (cur->next);
+            destroyNode(toDel);
+        }
     }
 
-    void enqueue(TaskT&& task) {
-        Node* newTail = new Node(std::move(task));
+private:
+    static void destroyChain(Node* first) {
+        while (first != nullptr) {
+            Node* next = first->next.load(std::memory_order_relaxed);
+            destroyNode(first);
+            first = next;
+        }
+    }
 
+    // Appends a privately built chain first -> ... -> newTail with a single CAS
+    void linkChain(Node* first, Node* newTail) {
+        typename Reclaim::Guard guard;
         while (true) {
             Node* curTail = tail_.load(std::memory_order_relaxed);
 
             // объявление указателя как hazard. HP – thread-private массив
-            smr::myMaster.hptrs[0] = curTail;
+            guard.Protect(0, curTail);
 
             // обязательно проверяем, что tail_ не изменился
             if (curTail != tail_.load(std::memory_order_acquire)) {
@@ -203,19 +272,46 @@ public:
             }
 
             Node* nextNullptr = nullptr;
-            if (curTail->next.compare_exchange_strong(nextNullptr, newTail,
+            if (curTail->next.compare_exchange_strong(nextNullptr, first,
                                                       std::memory_order_release)) {
                 tail_.compare_exchange_strong(curTail, newTail, std::memory_order_acq_rel);
-                smr::myMaster.hptrs[0] = nullptr; // обнуляем hazard pointer
                 break;
             }
         }
     }
 
+public:
+    void enqueue(TaskT&& task) {
+        Node* node = createNode(std::move(task));
+        linkChain(node, node);
+    }
+
+    // Tasks are moved out of [first, last) and appended in order with one CAS
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        if (first == last) {
+            return;
+        }
+        Node* chainHead = createNode(std::move(*first));
+        Node* chainTail = chainHead;
+        try {
+            for (++first; first != last; ++first) {
+                Node* node = createNode(std::move(*first));
+                chainTail->next.store(node, std::memory_order_relaxed);
+                chainTail = node;
+            }
+        } catch (...) {
+            destroyChain(chainHead);
+            throw;
+        }
+        linkChain(chainHead, chainTail);
+    }
+
     bool dequeue(TaskT& task) {
+        typename Reclaim::Guard guard;
         while (true) {
             Node* curHead = head_.load(std::memory_order_relaxed);
-            smr::myMaster.hptrs[0] = curHead;
+            guard.Protect(0, curHead);
 
             if (curHead != head_.load(std::memory_order_acquire)) {
                 continue;
@@ -224,14 +320,13 @@ public:
             Node* curTail = tail_.load(std::memory_order_relaxed);
             Node* next = curHead->next.load(std::memory_order_acquire);
 
-            smr::myMaster.hptrs[1] = next;
+            guard.Protect(1, next);
 
             if (curHead != head_.load(std::memory_order_relaxed)) {
                 continue;
             }
 
             if (next == nullptr) {
-                smr::myMaster.hptrs[0] = nullptr;
                 return false;
             }
 
@@ -240,18 +335,17 @@ public:
                 continue;
             }
 
-            task = std::move(next->task);
-
             // Есть ненулевая вероятность, что T1 запомнит в регистрах curHead и Next, при этом не успеет
             // сделать CAS и будет вытеснен планировщиком -> потенциальная ABA.
             // Но этого не произойдёт, так как, благодаря системе hazard-указателей, 
             // curHead и next не могли быть отданы аллокатору из других потоков, следовательно, 
             // не могли быть повторно аллоцированы.
             if (head_.compare_exchange_strong(curHead, next, std::memory_order_release)) {
-                smr::myMaster.hptrs[0] = nullptr;
-                smr::myMaster.hptrs[1] = nullptr;
+                // next стал новым sentinel, его задачу читает только выигравший CAS
+                task = std::move(next->task);
+                guard.Reset();
 
-                smr::myMaster.RetireNode(curHead);
+                Reclaim::Retire(curHead, destroyNode);
                 break;
             }
         }
@@ -259,11 +353,28 @@ public:
         return true;
     }
 
+    // The reclamation guard protects one node at a time, so the batch is taken node by node
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        size_t taken = 0;
+        TaskT task;
+        while (taken < max && dequeue(task)) {
+            *out++ = std::move(task);
+            ++taken;
+        }
+        return taken;
+    }
+
     bool empty() const {
         return head_.load() == tail_.load();
     }
  };
 
+// Kogan-Petrank wait-free queue, see waitfree_unbounded_queue.hpp
+template <typename TaskT>
+class uniQueue<TaskT, LIST | UNBOUNDED | WAITFREE | NOTPRIOR>
+        : public WaitfreeUnboundedQueue<TaskT> {};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // ARRAY-CORE
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -348,19 +459,26 @@ public:
         sift_up(array_.size() - 1);
     }
 
+    void h_insert(ValT&& val) {
+        array_.push_back(std::move(val));
+        sift_up(array_.size() - 1);
+    }
+
     void h_erase_by_index(size_t index) {
         assert(index < array_.size());
         std::swap(array_[array_.size() - 1], array_[index]);
         array_.pop_back();
-        sift_down(index);
-        sift_up(index);
+        if (index < array_.size()) {
+            sift_down(index);
+            sift_up(index);
+        }
     }
 
     void h_erase_by_value(const ValT& val) {
         CmpT cmp = CmpT();
         auto it = std::find(array_.begin(), array_.end(), val);
         if (it != array_.end()) {
-            h_erase_by_index(std::distance(it, array_.begin()));
+            h_erase_by_index(std::distance(array_.begin(), it));
         }
     }
 
@@ -368,6 +486,19 @@ public:
         h_erase_by_index(0);
     }
 
+    // Moves the top out instead of copying it, for move-only values
+    ValT h_pop_top() {
+        assert(array_.size() > 0);
+        ValT top = std::move(array_[0]);
+        h_erase_by_index(0);
+        return top;
+    }
+
+    const ValT& h_peek_top() const {
+        assert(array_.size() > 0);
+        return array_[0];
+    }
+
     void h_erase_bottom() {
         CmpT cmp = CmpT();
         auto last_element = array_.begin() + (array_.size() / 2);
@@ -376,7 +507,7 @@ public:
                 last_element = it;
             }
         }
-        erase_by_index(std::distance(last_element, array_.begin()));
+        h_erase_by_index(std::distance(array_.begin(), last_element));
     }
 
     ValT h_top() const {
@@ -434,97 +565,673 @@ public:
     // }
 };
 
+// Relaxed concurrent priority queue (MultiQueue, Rihani, Sanders & Dementiev)
+//
+// Tasks are spread over many small binary heaps, several per hardware thread, each behind a
+// try-lock of its own. enqueue pushes into a random heap; dequeue samples two heaps, compares
+// the top priorities cached next to their locks and pops from the better one. A thread that
+// finds a heap taken just samples again, so nobody waits for a particular lock holder and there
+// is no single point of contention. The price is relaxation: dequeue returns one of the highest
+// ranked tasks, not necessarily the highest one, the expected rank error grows with the number
+// of heaps. dequeue returns false only after a scan found every heap empty.
+//
+// The priority of a task is its `priority` member if it has one, the task itself otherwise. It
+// must be integral and larger values come first, e.g. ~deadline for earliest deadline first.
 template <typename TaskT>
-class uniQueue<TaskT, ARRAY | BLOCKING | NOTPRIOR | BOUNDED> {
+class uniQueue<TaskT, ARRAY | UNBOUNDED | PRIOR | BLOCKING> {
 private:
-    uint64_t size_{};
+    static constexpr uint64_t HEAPS_PER_THREAD = 4;
+    // tasks of a batch that go to the same heap
+    static constexpr uint64_t BULK_RUN = 16;
+    // samples that hit empty heaps before dequeue falls back to a scan
+    static constexpr uint64_t EMPTY_SAMPLES = 4;
+
+    // order-preserving map of the priority onto uint64_t
+    static uint64_t priorityKey(const TaskT& task) {
+        const auto& priority = [&task]() -> const auto& {
+            if constexpr (requires { task.priority; }) {
+                return task.priority;
+            } else {
+                return task;
+            }
+        }();
+        using PriorityT = std::remove_cvref_t<decltype(priority)>;
+        static_assert(std::is_integral_v<PriorityT>, "task priority must be integral");
+
+        if constexpr (std::is_signed_v<PriorityT>) {
+            return static_cast<uint64_t>(static_cast<int64_t>(priority)) ^ (1ULL << 63);
+        } else {
+            return static_cast<uint64_t>(priority);
+        }
+    }
 
-    mutable std::mutex mut_;
-    std::condition_variable condProd_;
-    std::condition_variable condCons_;
+    struct KeyLess {
+        bool operator()(const TaskT& lhs, const TaskT& rhs) const {
+            return priorityKey(lhs) < priorityKey(rhs);
+        }
+    };
 
-    std::vector<TaskT> buffer_;
+    struct alignas(CACHE_LINE) SubHeap {
+        std::atomic<bool> locked{false};
+        // hints for samplers, refreshed on every unlock
+        std::atomic<uint64_t> topKey{0};
+        std::atomic<uint64_t> size{0};
+        BinHeap<TaskT, KeyLess> heap;
 
-    uint64_t dequeuePos_{};
-    uint64_t enqueuePos_{};
+        bool tryLock() {
+            return !locked.load(std::memory_order_relaxed) &&
+                   !locked.exchange(true, std::memory_order_acquire);
+        }
 
-    bool full_ = false;
-    bool empty_ = true;
-    bool done_ = false;
+        void lock() {
+            while (!tryLock()) {
+                std::this_thread::yield();
+            }
+        }
 
-    // 34****12
-    //  |    |
-    //  b    f
+        void unlock() {
+            size.store(heap.size(), std::memory_order_relaxed);
+            topKey.store(heap.empty() ? 0 : priorityKey(heap.h_peek_top()),
+                         std::memory_order_relaxed);
+            locked.store(false, std::memory_order_release);
+        }
+
+        // Pops the top and unlocks, false if the heap was empty
+        bool popAndUnlock(TaskT& task) {
+            if (heap.empty()) {
+                unlock();
+                return false;
+            }
+            task = heap.h_pop_top();
+            unlock();
+            return true;
+        }
+    };
+
+    uint64_t count_;
+    std::unique_ptr<SubHeap[]> heaps_;
+
+    SubHeap& sample() {
+        return heaps_[((fastRandom() >> 32) * count_) >> 32];
+    }
+
+    SubHeap& lockRandom() {
+        while (true) {
+            SubHeap& heap = sample();
+            if (heap.tryLock()) {
+                return heap;
+            }
+        }
+    }
+
+    // The heap of the two whose top comes first, an empty one only if both are
+    static SubHeap& better(SubHeap& lhs, SubHeap& rhs) {
+        if (lhs.size.load(std::memory_order_relaxed) == 0) {
+            return rhs;
+        }
+        if (rhs.size.load(std::memory_order_relaxed) == 0) {
+            return lhs;
+        }
+        return rhs.topKey.load(std::memory_order_relaxed) >
+                               lhs.topKey.load(std::memory_order_relaxed)
+                       ? rhs
+                       : lhs;
+    }
+
+    // Visits every heap once, starting at a random one
+    bool scan(TaskT& task) {
+        uint64_t start = fastRandom() % count_;
+        for (uint64_t i = 0; i < count_; ++i) {
+            SubHeap& heap = heaps_[(start + i) % count_];
+            if (heap.size.load(std::memory_order_acquire) == 0) {
+                continue;
+            }
+            heap.lock();
+            if (heap.popAndUnlock(task)) {
+                return true;
+            }
+        }
+        return false;
+    }
 
 public:
-    BlockingBoundedQueue(): BlockingBoundedQueue(32){};
-    BlockingBoundedQueue(uint64_t size): buffer_(size) {
+    // `heaps` = 0 picks HEAPS_PER_THREAD per hardware thread
+    explicit uniQueue(uint64_t heaps = 0)
+        : count_(heaps != 0 ? heaps
+                            : std::max<uint64_t>(2, HEAPS_PER_THREAD *
+                                                            std::thread::hardware_concurrency())),
+          heaps_(std::make_unique<SubHeap[]>(count_)) {
     }
 
-    // Some producer sends the data to the queue
-    // Then condProd_ waits while buffer is full or skips waiting if it's not full
-    // Then it pushes data to the end of the queue (if enqueuePos_ overtakes frontIdx then the queue
-    // is full)
+    uniQueue(const uniQueue&) = delete;
+    uniQueue& operator=(const uniQueue&) = delete;
+
     void enqueue(TaskT&& task) {
-        std::unique_lock<std::mutex> guard{mut_};
+        SubHeap& heap = lockRandom();
+        heap.heap.h_insert(std::move(task));
+        heap.unlock();
+    }
+
+    bool dequeue(TaskT& task) {
+        for (uint64_t misses = 0; misses < EMPTY_SAMPLES;) {
+            SubHeap& heap = better(sample(), sample());
+            if (!heap.tryLock()) {
+                continue;
+            }
+            if (heap.popAndUnlock(task)) {
+                return true;
+            }
+            ++misses;
+        }
+        return scan(task);
+    }
+
+    // Runs of BULK_RUN tasks go to one heap per lock
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        while (first != last) {
+            SubHeap& heap = lockRandom();
+            for (uint64_t i = 0; i < BULK_RUN && first != last; ++i, ++first) {
+                heap.heap.h_insert(std::move(*first));
+            }
+            heap.unlock();
+        }
+    }
+
+    // Every task is sampled on its own, taking a run from one heap would make it much less exact
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        size_t taken = 0;
+        TaskT task;
+        while (taken < max && dequeue(task)) {
+            *out++ = std::move(task);
+            ++taken;
+        }
+        return taken;
+    }
+
+    bool empty() const {
+        for (uint64_t i = 0; i < count_; ++i) {
+            if (heaps_[i].size.load(std::memory_order_acquire) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Lock-free ring that parks on full and empty, see BlockingBoundedQueue
+template <typename TaskT>
+class uniQueue<TaskT, ARRAY | BLOCKING | NOTPRIOR | BOUNDED> : public BlockingBoundedQueue<TaskT> {
+public:
+    using BlockingBoundedQueue<TaskT>::BlockingBoundedQueue;
+};
+
+// Vyukov's bounded MPMC ring, see mpmc_bounded_queue. Layout::PaddedCells and
+// Layout::Scrambled select the cell layouts that keep neighbouring claims off one cache line.
+template <typename TaskT>
+class uniQueue<TaskT, ARRAY | LOCKFREE | NOTPRIOR | BOUNDED>
+    : public mpmc_bounded_queue<TaskT, RingLayout::Packed> {
+public:
+    using mpmc_bounded_queue<TaskT, RingLayout::Packed>::mpmc_bounded_queue;
+};
+
+template <typename TaskT>
+class uniQueue<TaskT, ARRAY | LOCKFREE | NOTPRIOR | BOUNDED | PADDEDCELLS>
+    : public mpmc_bounded_queue<TaskT, RingLayout::PaddedCells> {
+public:
+    using mpmc_bounded_queue<TaskT, RingLayout::PaddedCells>::mpmc_bounded_queue;
+};
+
+template <typename TaskT>
+class uniQueue<TaskT, ARRAY | LOCKFREE | NOTPRIOR | BOUNDED | SCRAMBLED>
+    : public mpmc_bounded_queue<TaskT, RingLayout::Scrambled> {
+public:
+    using mpmc_bounded_queue<TaskT, RingLayout::Scrambled>::mpmc_bounded_queue;
+};
+
+// Segmented FAA queue: a Michael-Scott list of fixed-size ring segments
+//
+// Producers and consumers claim cells with a single fetch_add on the segment's enqueue or
+// dequeue index instead of CAS-looping on a shared head or tail, so under contention every
+// thread gets a distinct cell per attempt. A consumer that overtakes a producer marks the cell
+// TAKEN; the producer's publishing CAS then fails and it retries on a fresh cell. Once a
+// segment's cells are used up a new one is linked behind it, and the consumer that runs off the
+// end of a segment unlinks it and retires it through the reclamation policy (see reclaim.h).
+// With reclaim::QuiescentState every thread using the queue has to call Reclaim::Quiescent()
+// between operations now and then.
+template <typename TaskT, typename Reclaim>
+class uniQueue<TaskT, ARRAY | UNBOUNDED | LOCKFREE | NOTPRIOR, Reclaim> {
+private:
+    static constexpr uint64_t SEGMENT_SIZE = 1024;
+
+    enum CellState : uint64_t { EMPTY = 0, FULL = 1, TAKEN = 2 };
 
-        condProd_.wait(guard, [this] {
-            return !full_;
-        });
+    struct Cell {
+        std::atomic<uint64_t> state{EMPTY};
+        // only the producer that claimed the cell writes it, only a consumer that saw FULL reads it
+        alignas(TaskT) unsigned char storage[sizeof(TaskT)];
 
-        buffer_[enqueuePos_] = std::move(task);
-        enqueuePos_ = (enqueuePos_ + 1) % buffer_.size();
+        TaskT* task() {
+            return std::launder(reinterpret_cast<TaskT*>(storage));
+        }
+    };
 
-        size_++;
-        if (size_ == buffer_.size()) {
-            full_ = true;
+    struct Segment {
+        std::atomic<uint64_t> enqueueIdx{0};
+        std::atomic<uint64_t> dequeueIdx{0};
+        std::atomic<Segment*> next{nullptr};
+        std::array<Cell, SEGMENT_SIZE> cells;
+
+        ~Segment() {
+            for (auto& cell : cells) {
+                if (cell.state.load(std::memory_order_relaxed) == FULL) {
+                    cell.task()->~TaskT();
+                }
+            }
         }
-        empty_ = false;
+    };
+
+    std::atomic<Segment*> head_;
+    std::atomic<Segment*> tail_;
 
-        guard.unlock();
-        condCons_.notify_one();
+    static void deleteSegment(void* ptr) {
+        delete static_cast<Segment*>(ptr);
     }
 
-    bool dequeue(TaskT& task) {
-        std::unique_lock<std::mutex> guard{mut_};
+    // Builds the task in a cell the caller owns and tries to publish it.
+    // On failure the task is moved back into `task`.
+    static bool publish(Cell& cell, TaskT& task) {
+        new (cell.storage) TaskT(std::move(task));
+        uint64_t expected = EMPTY;
+        if (cell.state.compare_exchange_strong(expected, FULL, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+            return true;
+        }
+        task = std::move(*cell.task());
+        cell.task()->~TaskT();
+        return false;
+    }
 
-        condCons_.wait(guard, [this] {
-            return !empty_ || done_;
-        });
+    // Appends a segment that already holds task in its first cell
+    bool appendSegment(Segment* tail, TaskT& task) {
+        Segment* segment = new Segment;
+        segment->enqueueIdx.store(1, std::memory_order_relaxed);
+        new (segment->cells[0].storage) TaskT(std::move(task));
+        segment->cells[0].state.store(FULL, std::memory_order_relaxed);
+
+        Segment* nextNullptr = nullptr;
+        if (tail->next.compare_exchange_strong(nextNullptr, segment, std::memory_order_release)) {
+            tail_.compare_exchange_strong(tail, segment, std::memory_order_release);
+            return true;
+        }
+
+        task = std::move(*segment->cells[0].task());
+        segment->cells[0].task()->~TaskT();
+        segment->cells[0].state.store(EMPTY, std::memory_order_relaxed);
+        delete segment;
+        return false;
+    }
 
-        if (empty_) {
+    // Consumer side of a claimed cell: false if the producer has not published it yet, the
+    // cell is then burnt and the producer retries elsewhere
+    template <typename OutIt>
+    static bool take(Cell& cell, OutIt& out) {
+        if (cell.state.exchange(TAKEN, std::memory_order_acq_rel) != FULL) {
             return false;
         }
+        *out++ = std::move(*cell.task());
+        cell.task()->~TaskT();
+        return true;
+    }
 
-        task = std::move(buffer_[dequeuePos_]);
-        dequeuePos_ = (dequeuePos_ + 1) % buffer_.size();
+    Segment* protectTail(typename Reclaim::Guard& guard) {
+        while (true) {
+            Segment* tail = tail_.load(std::memory_order_relaxed);
+            guard.Protect(0, tail);
+            if (tail == tail_.load(std::memory_order_acquire)) {
+                return tail;
+            }
+        }
+    }
 
-        size_--;
-        if (size_ == 0) {
-            empty_ = true;
+    Segment* protectHead(typename Reclaim::Guard& guard) const {
+        while (true) {
+            Segment* head = head_.load(std::memory_order_relaxed);
+            guard.Protect(0, head);
+            if (head == head_.load(std::memory_order_acquire)) {
+                return head;
+            }
         }
-        full_ = false;
+    }
 
-        guard.unlock();
-        condProd_.notify_one();
+    // Called once head's cells are used up, false if no segment follows
+    bool advanceHead(Segment* head, typename Reclaim::Guard& guard) {
+        Segment* next = head->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        // tail_ must never point to an unlinked segment
+        Segment* tail = tail_.load(std::memory_order_acquire);
+        if (tail == head) {
+            tail_.compare_exchange_strong(tail, next, std::memory_order_release);
+        }
+        if (head_.compare_exchange_strong(head, next, std::memory_order_release)) {
+            guard.Reset();
+            Reclaim::Retire(head, deleteSegment);
+        }
         return true;
     }
 
-    void wakeUp() {
-        std::unique_lock<std::mutex> guard{mut_};
-        done_ = true;
-        guard.unlock();
-        condCons_.notify_all();
+public:
+    uniQueue() {
+        Segment* first = new Segment;
+        head_.store(first, std::memory_order_release);
+        tail_.store(first, std::memory_order_release);
+    }
+
+    ~uniQueue() {
+        Segment* cur = head_.load(std::memory_order_acquire);
+        while (cur != nullptr) {
+            Segment* next = cur->next.load(std::memory_order_relaxed);
+            delete cur;
+            cur = next;
+        }
+    }
+
+    void enqueue(TaskT&& task) {
+        typename Reclaim::Guard guard;
+        while (true) {
+            Segment* tail = protectTail(guard);
+
+            uint64_t idx = tail->enqueueIdx.fetch_add(1, std::memory_order_relaxed);
+            if (idx < SEGMENT_SIZE) {
+                if (publish(tail->cells[idx], task)) {
+                    break;
+                }
+                continue;
+            }
+
+            // the segment is used up, append a new one or help whoever already did
+            Segment* next = tail->next.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                tail_.compare_exchange_strong(tail, next, std::memory_order_release);
+            } else if (appendSegment(tail, task)) {
+                break;
+            }
+        }
+    }
+
+    bool dequeue(TaskT& task) {
+        typename Reclaim::Guard guard;
+        TaskT* out = &task;
+        bool res = false;
+        while (true) {
+            Segment* head = protectHead(guard);
+
+            // cheap emptiness check, keeps idle consumers from burning dequeue cells
+            if (head->dequeueIdx.load(std::memory_order_relaxed) >=
+                        head->enqueueIdx.load(std::memory_order_acquire) &&
+                head->next.load(std::memory_order_acquire) == nullptr) {
+                break;
+            }
+
+            uint64_t idx = head->dequeueIdx.fetch_add(1, std::memory_order_relaxed);
+            if (idx < SEGMENT_SIZE) {
+                if (take(head->cells[idx], out)) {
+                    res = true;
+                    break;
+                }
+                continue;
+            }
+
+            if (!advanceHead(head, guard)) {
+                break;
+            }
+        }
+        return res;
+    }
+
+    // Claims a run of cells with one fetch_add per segment. A cell lost to a consumer is
+    // skipped and its task goes into the next claimed cell, so the batch stays in order.
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        auto left = static_cast<uint64_t>(std::distance(first, last));
+        typename Reclaim::Guard guard;
+        while (left > 0) {
+            Segment* tail = protectTail(guard);
+
+            uint64_t want = std::min(left, SEGMENT_SIZE);
+            uint64_t idx = tail->enqueueIdx.fetch_add(want, std::memory_order_relaxed);
+            for (uint64_t end = std::min(idx + want, SEGMENT_SIZE); idx < end; ++idx) {
+                if (publish(tail->cells[idx], *first)) {
+                    ++first;
+                    --left;
+                }
+            }
+            if (left == 0 || idx < SEGMENT_SIZE) {
+                continue;
+            }
+
+            Segment* next = tail->next.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                tail_.compare_exchange_strong(tail, next, std::memory_order_release);
+            } else if (appendSegment(tail, *first)) {
+                ++first;
+                --left;
+            }
+        }
+    }
+
+    // Claims as many cells as look filled with one fetch_add per segment
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        size_t taken = 0;
+        typename Reclaim::Guard guard;
+        while (taken < max) {
+            Segment* head = protectHead(guard);
+
+            uint64_t dequeued = head->dequeueIdx.load(std::memory_order_relaxed);
+            uint64_t enqueued = head->enqueueIdx.load(std::memory_order_acquire);
+            if (dequeued >= enqueued && head->next.load(std::memory_order_acquire) == nullptr) {
+                break;
+            }
+
+            uint64_t ready = dequeued < enqueued ? enqueued - dequeued : 1;
+            uint64_t want = std::min<uint64_t>({max - taken, ready, SEGMENT_SIZE});
+            uint64_t idx = head->dequeueIdx.fetch_add(want, std::memory_order_relaxed);
+            for (uint64_t end = std::min(idx + want, SEGMENT_SIZE); idx < end; ++idx) {
+                if (take(head->cells[idx], out)) {
+                    ++taken;
+                }
+            }
+
+            if (idx >= SEGMENT_SIZE && !advanceHead(head, guard)) {
+                break;
+            }
+        }
+        return taken;
     }
 
     bool empty() const {
+        typename Reclaim::Guard guard;
+        Segment* head = protectHead(guard);
+        return head->next.load(std::memory_order_acquire) == nullptr &&
+               head->dequeueIdx.load() >= head->enqueueIdx.load();
+    }
+};
+
+template <typename TaskT>
+class uniQueue<TaskT, ARRAY | BLOCKING | NOTPRIOR | UNBOUNDED> {
+private:
+    mutable std::mutex mut_;
+    std::queue<TaskT, std::deque<TaskT>> queue_;
+
+public:
+    void enqueue(TaskT&& task) {
+        std::lock_guard<std::mutex> guard{mut_};
+        queue_.push(std::move(task));
+    }
+
+    bool dequeue(TaskT& task) {
         std::unique_lock<std::mutex> guard{mut_};
-        return empty_ && done_;
+
+        if (queue_.empty()) {
+            return false;
+        }
+
+        task = std::move(queue_.front());
+        queue_.pop();
+
+        return true;
+    }
+
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        std::lock_guard<std::mutex> guard{mut_};
+        for (; first != last; ++first) {
+            queue_.push(std::move(*first));
+        }
+    }
+
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        std::lock_guard<std::mutex> guard{mut_};
+
+        size_t taken = 0;
+        for (; taken < max && !queue_.empty(); ++taken) {
+            *out++ = std::move(queue_.front());
+            queue_.pop();
+        }
+        return taken;
+    }
+
+    bool empty() const {
+        return queue_.empty();
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SINGLE-PRODUCER / SINGLE-CONSUMER SPECIALIZATIONS
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Single-producer single-consumer ring (Lamport, with cached indices)
+//
+// Each side owns its index and is the only one to store it, so there is no CAS anywhere. Every
+// side also keeps a private copy of the other side's index and rereads the shared one only when
+// the copy says the ring is full (producer) or empty (consumer); in the steady state the two
+// index cache lines are not bounced between the cores at all. dequeue is wait-free, enqueue is
+// too as long as the ring has room and yields until the consumer frees a cell otherwise. The
+// size is rounded up to a power of two.
+template <typename TaskT>
+class uniQueue<TaskT, ARRAY | BOUNDED | LOCKFREE | NOTPRIOR | SINGLEPROD | SINGLECONS> {
+private:
+    std::vector<TaskT> buffer_;
+    uint64_t bufMask_;
+
+    // written by the producer
+    alignas(CACHE_LINE) std::atomic<uint64_t> enqueuePos_{0};
+    uint64_t cachedDequeuePos_ = 0;
+
+    // written by the consumer
+    alignas(CACHE_LINE) std::atomic<uint64_t> dequeuePos_{0};
+    uint64_t cachedEnqueuePos_ = 0;
+
+    // Cells the producer can fill starting at pos, rereads the consumer's index if needed
+    uint64_t freeCells(uint64_t pos, uint64_t want) {
+        uint64_t free = bufMask_ + 1 - (pos - cachedDequeuePos_);
+        if (free < want) {
+            cachedDequeuePos_ = dequeuePos_.load(std::memory_order_acquire);
+            free = bufMask_ + 1 - (pos - cachedDequeuePos_);
+        }
+        return free;
+    }
+
+    // Cells the consumer can take starting at pos, rereads the producer's index if needed
+    uint64_t filledCells(uint64_t pos, uint64_t want) {
+        uint64_t filled = cachedEnqueuePos_ - pos;
+        if (filled < want) {
+            cachedEnqueuePos_ = enqueuePos_.load(std::memory_order_acquire);
+            filled = cachedEnqueuePos_ - pos;
+        }
+        return filled;
+    }
+
+public:
+    uniQueue(uint64_t size = 128)
+        : buffer_(std::bit_ceil(std::max<uint64_t>(size, 2))), bufMask_(buffer_.size() - 1) {
+    }
+
+    uniQueue(const uniQueue&) = delete;
+    uniQueue& operator=(const uniQueue&) = delete;
+
+    void enqueue(TaskT&& task) {
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (freeCells(pos, 1) == 0) {
+            std::this_thread::yield();
+        }
+        buffer_[pos & bufMask_] = std::move(task);
+        enqueuePos_.store(pos + 1, std::memory_order_release);
+    }
+
+    bool dequeue(TaskT& task) {
+        uint64_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        if (filledCells(pos, 1) == 0) {
+            return false;
+        }
+        task = std::move(buffer_[pos & bufMask_]);
+        dequeuePos_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Fills as many cells as there is room for and publishes them with one store
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        auto left = static_cast<uint64_t>(std::distance(first, last));
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (left > 0) {
+            uint64_t count = std::min(left, freeCells(pos, left));
+            if (count == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (uint64_t i = 0; i < count; ++i, ++first) {
+                buffer_[(pos + i) & bufMask_] = std::move(*first);
+            }
+            pos += count;
+            left -= count;
+            enqueuePos_.store(pos, std::memory_order_release);
+        }
+    }
+
+    // Takes every filled cell up to max and frees them with one store
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        uint64_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        uint64_t count = std::min<uint64_t>(max, filledCells(pos, max));
+        for (uint64_t i = 0; i < count; ++i) {
+            *out++ = std::move(buffer_[(pos + i) & bufMask_]);
+        }
+        if (count != 0) {
+            dequeuePos_.store(pos + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    bool empty() const {
+        return enqueuePos_.load(std::memory_order_acquire) ==
+               dequeuePos_.load(std::memory_order_acquire);
     }
 };
 
+// Single-producer multi-consumer ring
+//
+// Vyukov's bounded ring with the producer's CAS taken out: only one thread moves enqueuePos_,
+// so it waits for its next cell to come free and advances the position with a plain store.
+// Consumers still race for cells with a CAS on dequeuePos_ exactly as in the MPMC ring. The
+// size is rounded up to a power of two.
 template <typename TaskT>
-class uniQueue<TaskT, ARRAY | LOCKFREE | NOTPRIOR | BOUNDED> {
+class uniQueue<TaskT, ARRAY | BOUNDED | LOCKFREE | NOTPRIOR | SINGLEPROD> {
 private:
     struct Cell {
         std::atomic<uint64_t> sequence;
@@ -533,77 +1240,113 @@ private:
 
     std::vector<Cell> buffer_;
     uint64_t bufMask_;
-    std::atomic<uint64_t> enqueuePos_;
-    std::atomic<uint64_t> dequeuePos_;
+    alignas(CACHE_LINE) std::atomic<uint64_t> enqueuePos_{0};
+    alignas(CACHE_LINE) std::atomic<uint64_t> dequeuePos_{0};
+
+    // Waits until the cell for pos has been emptied by the previous round of consumers
+    Cell& freeCell(uint64_t pos) {
+        Cell& cell = buffer_[pos & bufMask_];
+        while (cell.sequence.load(std::memory_order_acquire) != pos) {
+            std::this_thread::yield();
+        }
+        return cell;
+    }
 
 public:
-    LockfreeBoundedQueue(uint64_t size = 128): buffer_(size), bufMask_(size - 1) {
-        for (uint64_t i = 0; i < size; i++) {
+    uniQueue(uint64_t size = 128)
+        : buffer_(std::bit_ceil(std::max<uint64_t>(size, 2))), bufMask_(buffer_.size() - 1) {
+        for (uint64_t i = 0; i < buffer_.size(); i++) {
             buffer_[i].sequence.store(i, std::memory_order_relaxed);
         }
-
-        enqueuePos_.store(0, std::memory_order_relaxed);
-        dequeuePos_.store(0, std::memory_order_relaxed);
     }
 
+    uniQueue(const uniQueue&) = delete;
+    uniQueue& operator=(const uniQueue&) = delete;
+
     void enqueue(TaskT&& task) {
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell& cell = freeCell(pos);
+        cell.task = std::move(task);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        enqueuePos_.store(pos + 1, std::memory_order_relaxed);
+    }
+
+    bool dequeue(TaskT& task) {
         Cell* cell;
-        uint64_t pos;
-        bool res = false;
+        uint64_t pos = dequeuePos_.load(std::memory_order_relaxed);
 
-        while (!res) {
-            // fetch the current Position where to enqueue the item
-            pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (true) {
             cell = &buffer_[pos & bufMask_];
             auto seq = cell->sequence.load(std::memory_order_acquire);
-            auto diff = static_cast<int>(seq) - static_cast<int>(pos);
+            auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
 
-            // queue is full we cannot enqueue and just continue
-            // another option: queue moved forward all way round
             if (diff < 0) {
-                continue;
+                return false;
             }
-
-            // If its Sequence wasn't touched by other producers
-            // check if we can increment the enqueue Position
             if (diff == 0) {
-                res = enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed);
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
             }
         }
 
-        // write the item we want to enqueue and bump Sequence
-        cell->task = std::move(task);
-        cell->sequence.store(pos + 1, std::memory_order_release);
+        task = std::move(cell->task);
+        cell->sequence.store(pos + bufMask_ + 1, std::memory_order_release);
+        return true;
     }
 
-    bool dequeue(TaskT& task) {
-        Cell* cell;
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (; first != last; ++first, ++pos) {
+            Cell& cell = freeCell(pos);
+            cell.task = std::move(*first);
+            cell.sequence.store(pos + 1, std::memory_order_release);
+        }
+        enqueuePos_.store(pos, std::memory_order_relaxed);
+    }
+
+    // Reserves a run of consecutive filled cells with a single CAS on dequeuePos_
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        if (max == 0) {
+            return 0;
+        }
+
         uint64_t pos;
-        bool res = false;
+        uint64_t count;
 
-        while (!res) {
-            // fetch the current Position from where we can dequeue an item
+        while (true) {
             pos = dequeuePos_.load(std::memory_order_relaxed);
-            cell = &buffer_[pos & bufMask_];
-            auto seq = cell->sequence.load(std::memory_order_acquire);
-            auto diff = static_cast<int>(seq) - static_cast<int>(pos + 1);
 
-            // probably the queue is empty, then return false
-            if (diff < 0) {
-                return false;
+            count = 0;
+            while (count < max && count <= bufMask_ &&
+                   buffer_[(pos + count) & bufMask_].sequence.load(std::memory_order_acquire) ==
+                           pos + count + 1) {
+                ++count;
             }
 
-            // Check if its Sequence was changed by a producer and wasn't changed by
-            // other consumers and if we can increment the dequeue Position
-            if (diff == 0) {
-                res = dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed);
+            if (count == 0) {
+                auto seq = buffer_[pos & bufMask_].sequence.load(std::memory_order_acquire);
+                if (static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1) < 0) {
+                    return 0;
+                }
+                continue;
+            }
+
+            if (dequeuePos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                break;
             }
         }
 
-        // read the item and update for the next round of the buffer
-        task = std::move(cell->task);
-        cell->sequence.store(pos + bufMask_ + 1, std::memory_order_release);
-        return true;
+        for (uint64_t i = 0; i < count; ++i) {
+            Cell& cell = buffer_[(pos + i) & bufMask_];
+            *out++ = std::move(cell.task);
+            cell.sequence.store(pos + i + bufMask_ + 1, std::memory_order_release);
+        }
+        return count;
     }
 
     bool empty() const {
@@ -611,32 +1354,128 @@ public:
     }
 };
 
+// Multi-producer single-consumer list (Vyukov)
+//
+// A producer swaps its node into head_ with one exchange and then links the previous head to
+// it; there is no retry loop, so enqueue is wait-free. The consumer alone walks from tail_, a
+// sentinel whose successor holds the next task, and frees the old sentinel right away: no other
+// thread ever reads a node behind head_, so no hazard pointers are needed. Nodes come from the
+// per-thread slab pool.
+//
+// Between a producer's exchange and its link the chain is cut, and dequeue reports empty even
+// though later producers may already have finished; the tasks show up as soon as the link is
+// written. empty() follows the consumer's view and must only be called by the consumer.
 template <typename TaskT>
-class uniQueue<TaskT, ARRAY | BLOCKING | NOTPRIOR | UNBOUNDED> {
+class uniQueue<TaskT, LIST | UNBOUNDED | LOCKFREE | NOTPRIOR | SINGLECONS> {
 private:
-    mutable std::mutex mut_;
-    std::queue<TaskT, std::deque<TaskT>> queue_;
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        TaskT task;
+
+        Node() {}
+        explicit Node(TaskT&& task): task(std::move(task)) {}
+    };
+
+    using NodePool = slab::Pool<sizeof(Node), alignof(Node)>;
+
+    alignas(CACHE_LINE) std::atomic<Node*> head_;
+    alignas(CACHE_LINE) Node* tail_;
+
+    template <typename... Args>
+    static Node* createNode(Args&&... args) {
+        void* mem = NodePool::Allocate();
+        try {
+            return new (mem) Node(std::forward<Args>(args)...);
+        } catch (...) {
+            NodePool::Deallocate(mem);
+            throw;
+        }
+    }
+
+    static void destroyNode(Node* node) {
+        node->~Node();
+        NodePool::Deallocate(node);
+    }
+
+    // Appends the already linked chain first..last
+    void linkChain(Node* first, Node* last) {
+        Node* prev = head_.exchange(last, std::memory_order_acq_rel);
+        prev->next.store(first, std::memory_order_release);
+    }
 
 public:
+    uniQueue() {
+        Node* sentinel = createNode();
+        head_.store(sentinel, std::memory_order_relaxed);
+        tail_ = sentinel;
+    }
+
+    uniQueue(const uniQueue&) = delete;
+    uniQueue& operator=(const uniQueue&) = delete;
+
+    ~uniQueue() {
+        while (tail_ != nullptr) {
+            Node* next = tail_->next.load(std::memory_order_relaxed);
+            destroyNode(tail_);
+            tail_ = next;
+        }
+    }
+
     void enqueue(TaskT&& task) {
-        std::lock_guard<std::mutex> guard{mut_};
-        queue_.push(std::move(task));
+        Node* node = createNode(std::move(task));
+        linkChain(node, node);
     }
 
     bool dequeue(TaskT& task) {
-        std::unique_lock<std::mutex> guard{mut_};
-
-        if (queue_.empty()) {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
             return false;
         }
+        task = std::move(next->task);
+        destroyNode(tail_);
+        tail_ = next;
+        return true;
+    }
 
-        task = std::move(queue_.front());
-        queue_.pop();
+    // Links the whole batch privately and publishes it with a single exchange
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        if (first == last) {
+            return;
+        }
 
-        return true;
+        Node* chainFirst = createNode(std::move(*first));
+        Node* chainLast = chainFirst;
+        for (++first; first != last; ++first) {
+            Node* node;
+            try {
+                node = createNode(std::move(*first));
+            } catch (...) {
+                while (chainFirst != nullptr) {
+                    Node* next = chainFirst->next.load(std::memory_order_relaxed);
+                    destroyNode(chainFirst);
+                    chainFirst = next;
+                }
+                throw;
+            }
+            chainLast->next.store(node, std::memory_order_relaxed);
+            chainLast = node;
+        }
+        linkChain(chainFirst, chainLast);
+    }
+
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        size_t taken = 0;
+        TaskT task;
+        while (taken < max && dequeue(task)) {
+            *out++ = std::move(task);
+            ++taken;
+        }
+        return taken;
     }
 
     bool empty() const {
-        return queue_.empty();
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
     }
 };
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <lib/common/task.hpp>
+#include <lib/common/epoch.h>
+#include <lib/common/slab_allocator.h>
+
+namespace wf {
+
+// Upper bound on threads using wait-free queues at the same time
+constexpr uint64_t MAX_THREADS = 256;
+
+// Dense thread ids in [0, MAX_THREADS), handed back when a thread exits
+class ThreadIds {
+private:
+    std::array<std::atomic<bool>, MAX_THREADS> taken_{};
+    std::atomic<uint64_t> highWater_{0};
+
+public:
+    uint64_t Acquire() {
+        for (uint64_t id = 0; id < MAX_THREADS; ++id) {
+            bool expected = false;
+            if (!taken_[id].load(std::memory_order_relaxed) &&
+                taken_[id].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                uint64_t high = highWater_.load(std::memory_order_relaxed);
+                while (high < id + 1 &&
+                       !highWater_.compare_exchange_weak(high, id + 1, std::memory_order_release)) {
+                }
+                return id;
+            }
+        }
+        REQUIRE(false, "More than ", MAX_THREADS, " threads use wait-free queues");
+        return MAX_THREADS;
+    }
+
+    void Release(uint64_t id) {
+        taken_[id].store(false, std::memory_order_release);
+    }
+
+    // ids at or above this were never handed out
+    uint64_t HighWater() const {
+        return highWater_.load(std::memory_order_acquire);
+    }
+};
+
+inline ThreadIds threadIds;
+
+struct ThreadId {
+    uint64_t id = threadIds.Acquire();
+
+    ~ThreadId() {
+        threadIds.Release(id);
+    }
+};
+
+inline uint64_t LocalId() {
+    thread_local ThreadId handle;
+    return handle.id;
+}
+
+} // namespace wf
+
+// Wait-free unbounded MPMC queue (Kogan & Petrank).
+//
+// Every operation takes a phase number and announces itself in a per-thread descriptor, then
+// helps every pending operation with a phase not greater than its own before finishing. An
+// operation can thus be overtaken by at most one round of the other threads, which bounds its
+// step count by the number of threads instead of leaving it in an open-ended CAS retry loop.
+// Linking follows the Michael-Scott list: a node is first attached to tail->next and the
+// enqueuer's descriptor is completed before tail moves; a dequeue first stamps its id into
+// the head node and only then swings head.
+//
+// Descriptors are immutable and replaced by CAS. Replaced descriptors and unlinked nodes are
+// reclaimed through ebr, both come from per-thread slab pools.
+template <typename TaskT>
+class WaitfreeUnboundedQueue {
+private:
+    static constexpr int64_t NO_THREAD = -1;
+
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        int64_t enqTid = NO_THREAD;
+        std::atomic<int64_t> deqTid = NO_THREAD;
+        TaskT task;
+
+        Node() {}
+        Node(TaskT&& task, int64_t tid): enqTid(tid), task(std::move(task)) {}
+    };
+
+    struct OpDesc {
+        uint64_t phase;
+        bool pending;
+        bool enqueue;
+        Node* node;
+    };
+
+    using NodePool = slab::Pool<sizeof(Node), alignof(Node)>;
+    using DescPool = slab::Pool<sizeof(OpDesc), alignof(OpDesc)>;
+
+    alignas(CACHE_LINE) std::atomic<Node*> head_;
+    alignas(CACHE_LINE) std::atomic<Node*> tail_;
+    alignas(CACHE_LINE) std::atomic<uint64_t> phase_{0};
+    std::array<std::atomic<OpDesc*>, wf::MAX_THREADS> state_;
+
+    template <typename... Args>
+    static Node* createNode(Args&&... args) {
+        void* mem = NodePool::Allocate();
+        try {
+            return new (mem) Node(std::forward<Args>(args)...);
+        } catch (...) {
+            NodePool::Deallocate(mem);
+            throw;
+        }
+    }
+
+    static void destroyNode(void* ptr) {
+        static_cast<Node*>(ptr)->~Node();
+        NodePool::Deallocate(ptr);
+    }
+
+    static OpDesc* createDesc(uint64_t phase, bool pending, bool enqueue, Node* node) {
+        return new (DescPool::Allocate()) OpDesc{phase, pending, enqueue, node};
+    }
+
+    static void destroyDesc(void* ptr) {
+        DescPool::Deallocate(ptr);
+    }
+
+    // Replaces the descriptor of tid, the winner retires the old one
+    bool swapDesc(uint64_t tid, OpDesc* cur, OpDesc* desc) {
+        if (state_[tid].compare_exchange_strong(cur, desc, std::memory_order_acq_rel)) {
+            ebr::Retire(cur, destroyDesc);
+            return true;
+        }
+        destroyDesc(desc);
+        return false;
+    }
+
+    bool isStillPending(uint64_t tid, uint64_t phase) const {
+        OpDesc* desc = state_[tid].load(std::memory_order_acquire);
+        return desc->pending && desc->phase <= phase;
+    }
+
+    void help(uint64_t phase) {
+        uint64_t threads = wf::threadIds.HighWater();
+        for (uint64_t tid = 0; tid < threads; ++tid) {
+            OpDesc* desc = state_[tid].load(std::memory_order_acquire);
+            if (desc->pending && desc->phase <= phase) {
+                if (desc->enqueue) {
+                    helpEnqueue(tid, phase);
+                } else {
+                    helpDequeue(tid, phase);
+                }
+            }
+        }
+    }
+
+    void helpEnqueue(uint64_t tid, uint64_t phase) {
+        while (isStillPending(tid, phase)) {
+            Node* last = tail_.load(std::memory_order_acquire);
+            Node* next = last->next.load(std::memory_order_acquire);
+            if (last != tail_.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (next != nullptr) {
+                // someone else's node is linked but tail lags behind
+                helpFinishEnqueue();
+                continue;
+            }
+            // read once: the node of a descriptor that is still pending after tail was read
+            // cannot be linked behind last yet
+            OpDesc* desc = state_[tid].load(std::memory_order_acquire);
+            if (desc->pending && desc->phase <= phase) {
+                Node* nextNullptr = nullptr;
+                if (last->next.compare_exchange_strong(nextNullptr, desc->node,
+                                                       std::memory_order_acq_rel)) {
+                    helpFinishEnqueue();
+                    return;
+                }
+            }
+        }
+    }
+
+    void helpFinishEnqueue() {
+        Node* last = tail_.load(std::memory_order_acquire);
+        Node* next = last->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return;
+        }
+        auto tid = static_cast<uint64_t>(next->enqTid);
+        OpDesc* cur = state_[tid].load(std::memory_order_acquire);
+        if (last == tail_.load(std::memory_order_acquire) && cur->node == next) {
+            if (cur->pending) {
+                swapDesc(tid, cur, createDesc(cur->phase, false, true, next));
+            }
+            tail_.compare_exchange_strong(last, next, std::memory_order_acq_rel);
+        }
+    }
+
+    void helpDequeue(uint64_t tid, uint64_t phase) {
+        while (isStillPending(tid, phase)) {
+            Node* first = head_.load(std::memory_order_acquire);
+            Node* last = tail_.load(std::memory_order_acquire);
+            Node* next = first->next.load(std::memory_order_acquire);
+            if (first != head_.load(std::memory_order_acquire)) {
+                continue;
+            }
+
+            if (first == last) {
+                if (next != nullptr) {
+                    helpFinishEnqueue();
+                    continue;
+                }
+                // empty queue: complete the dequeue with no node
+                OpDesc* cur = state_[tid].load(std::memory_order_acquire);
+                if (last == tail_.load(std::memory_order_acquire) && isStillPending(tid, phase)) {
+                    swapDesc(tid, cur, createDesc(cur->phase, false, false, nullptr));
+                }
+                continue;
+            }
+
+            OpDesc* cur = state_[tid].load(std::memory_order_acquire);
+            if (!cur->pending || cur->phase > phase) {
+                break;
+            }
+            if (first == head_.load(std::memory_order_acquire) && cur->node != first) {
+                // remember which head this dequeue is going to take
+                if (!swapDesc(tid, cur, createDesc(cur->phase, true, false, first))) {
+                    continue;
+                }
+            }
+            int64_t noThread = NO_THREAD;
+            first->deqTid.compare_exchange_strong(noThread, static_cast<int64_t>(tid),
+                                                  std::memory_order_acq_rel);
+            helpFinishDequeue();
+        }
+    }
+
+    void helpFinishDequeue() {
+        Node* first = head_.load(std::memory_order_acquire);
+        Node* next = first->next.load(std::memory_order_acquire);
+        int64_t tid = first->deqTid.load(std::memory_order_acquire);
+        if (tid == NO_THREAD) {
+            return;
+        }
+        OpDesc* cur = state_[tid].load(std::memory_order_acquire);
+        if (first == head_.load(std::memory_order_acquire) && next != nullptr) {
+            swapDesc(tid, cur, createDesc(cur->phase, false, false, cur->node));
+            if (head_.compare_exchange_strong(first, next, std::memory_order_acq_rel)) {
+                ebr::Retire(first, destroyNode);
+            }
+        }
+    }
+
+    // Publishes a new pending operation of the calling thread
+    void announce(uint64_t tid, OpDesc* desc) {
+        OpDesc* old = state_[tid].exchange(desc, std::memory_order_acq_rel);
+        ebr::Retire(old, destroyDesc);
+    }
+
+public:
+    WaitfreeUnboundedQueue() {
+        Node* sentinel = createNode();
+        head_.store(sentinel, std::memory_order_relaxed);
+        tail_.store(sentinel, std::memory_order_relaxed);
+        for (auto& desc : state_) {
+            desc.store(createDesc(0, false, true, nullptr), std::memory_order_relaxed);
+        }
+    }
+
+    WaitfreeUnboundedQueue(const WaitfreeUnboundedQueue&) = delete;
+    WaitfreeUnboundedQueue& operator=(const WaitfreeUnboundedQueue&) = delete;
+
+    ~WaitfreeUnboundedQueue() {
+        Node* cur = head_.load(std::memory_order_relaxed);
+        while (cur != nullptr) {
+            Node* next = cur->next.load(std::memory_order_relaxed);
+            destroyNode(cur);
+            cur = next;
+        }
+        for (auto& desc : state_) {
+            destroyDesc(desc.load(std::memory_order_relaxed));
+        }
+    }
+
+    void enqueue(TaskT&& task) {
+        uint64_t tid = wf::LocalId();
+        ebr::Guard guard;
+
+        uint64_t phase = phase_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        Node* node = createNode(std::move(task), static_cast<int64_t>(tid));
+        announce(tid, createDesc(phase, true, true, node));
+        help(phase);
+        helpFinishEnqueue();
+    }
+
+    bool dequeue(TaskT& task) {
+        uint64_t tid = wf::LocalId();
+        ebr::Guard guard;
+
+        uint64_t phase = phase_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        announce(tid, createDesc(phase, true, false, nullptr));
+        help(phase);
+        helpFinishDequeue();
+
+        // the node we took is the old head, the value lives in its successor
+        Node* node = state_[tid].load(std::memory_order_acquire)->node;
+        if (node == nullptr) {
+            return false;
+        }
+        task = std::move(node->next.load(std::memory_order_acquire)->task);
+        return true;
+    }
+
+    // Every task is its own wait-free operation: a batch cannot be announced as one descriptor
+    // without giving up the per-operation step bound
+    template <typename Iter>
+    void enqueueBulk(Iter first, Iter last) {
+        for (; first != last; ++first) {
+            enqueue(std::move(*first));
+        }
+    }
+
+    template <typename OutIt>
+    size_t dequeueBulk(OutIt out, size_t max) {
+        size_t taken = 0;
+        TaskT task;
+        while (taken < max && dequeue(task)) {
+            *out++ = std::move(task);
+            ++taken;
+        }
+        return taken;
+    }
+
+    bool empty() const {
+        ebr::Guard guard;
+        return head_.load(std::memory_order_acquire)->next.load(std::memory_order_acquire) ==
+               nullptr;
+    }
+};
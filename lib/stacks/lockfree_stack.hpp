@@ -1,40 +1,223 @@
 #pragma once
-#include <lib/common/task.hpp>
 
-// An example of completely wrong LF stack with ABA problem
+#include <lib/common/task.hpp>
+#include <lib/common/reclaim.h>
+#include <lib/common/slab_allocator.h>
+#include <lib/common/backoff.h>
 
-template <typename T>
+// Treiber stack with elimination backoff.
+//
+// push and pop CAS top_. Nodes come from a per-thread slab pool and are retired through the
+// reclamation policy (see reclaim.h), which keeps a node out of the pool while a pop can still
+// read it, so a recycled node can never make a stale CAS succeed (no ABA). When the CAS on top_
+// fails, the thread backs off into an elimination array instead of retrying right away: a push
+// offers its node in a random slot and waits a little, a pop that finds an offer takes it. The
+// pair cancels out without touching top_, so contention on the stack turns into throughput
+// instead of failed CAS. EliminationSlots = 0 turns elimination off.
+template <typename T, typename Reclaim = reclaim::HazardPointers, size_t EliminationSlots = 8>
 class lfStack {
 private:
     struct Node {
-        std::atomic<Node*> next;
+        Node* next = nullptr;
         T data;
 
-        Node(const T& data): data(data) {
+        template <typename... Args>
+        Node(Args&&... args): data(std::forward<Args>(args)...) {
         }
     };
 
-    std::atomic<Node*> top_ = nullptr;
+    using NodePool = slab::Pool<sizeof(Node), alignof(Node)>;
+
+    // pauses a push waits in its slot for a pop to come by
+    static constexpr uint32_t ELIMINATION_SPINS = 256;
+
+    struct alignas(CACHE_LINE) Slot {
+        // nullptr, a node offered by a push, or taken() once a pop has accepted the offer
+        std::atomic<Node*> offer{nullptr};
+    };
+
+    alignas(CACHE_LINE) std::atomic<Node*> top_{nullptr};
+    std::array<Slot, EliminationSlots> slots_;
+
+    template <typename... Args>
+    static Node* createNode(Args&&... args) {
+        void* mem = NodePool::Allocate();
+        try {
+            return new (mem) Node(std::forward<Args>(args)...);
+        } catch (...) {
+            NodePool::Deallocate(mem);
+            throw;
+        }
+    }
+
+    static void destroyNode(void* ptr) {
+        static_cast<Node*>(ptr)->~Node();
+        NodePool::Deallocate(ptr);
+    }
+
+    // never a node address, nodes are at least pointer-aligned
+    static Node* taken() {
+        return reinterpret_cast<Node*>(uintptr_t{1});
+    }
+
+    Slot& randomSlot() {
+        return slots_[((fastRandom() >> 32) * EliminationSlots) >> 32];
+    }
+
+    // Offers node to a concurrent pop, true if one took it
+    bool tryEliminatePush(Node* node) {
+        Slot& slot = randomSlot();
+        Node* expected = nullptr;
+        if (!slot.offer.compare_exchange_strong(expected, node, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < ELIMINATION_SPINS; ++i) {
+            if (slot.offer.load(std::memory_order_acquire) == taken()) {
+                break;
+            }
+            backoff::CpuRelax();
+        }
+        // withdraw the offer, unless a pop has taken it meanwhile
+        expected = node;
+        if (slot.offer.compare_exchange_strong(expected, nullptr, std::memory_order_acquire,
+                                               std::memory_order_acquire)) {
+            return false;
+        }
+        slot.offer.store(nullptr, std::memory_order_release);
+        return true;
+    }
+
+    // Takes an offered node, if any. The node never was on the stack, so nobody else can see it.
+    bool tryEliminatePop(T& data) {
+        Slot& slot = randomSlot();
+        Node* node = slot.offer.load(std::memory_order_acquire);
+        if (node == nullptr || node == taken() ||
+            !slot.offer.compare_exchange_strong(node, taken(), std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+            return false;
+        }
+        data = std::move(node->data);
+        destroyNode(node);
+        return true;
+    }
+
+    void pushNode(Node* node) {
+        Node* top = top_.load(std::memory_order_relaxed);
+        while (true) {
+            node->next = top;
+            if (top_.compare_exchange_weak(top, node, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+                return;
+            }
+            if constexpr (EliminationSlots > 0) {
+                if (tryEliminatePush(node)) {
+                    return;
+                }
+                top = top_.load(std::memory_order_relaxed);
+            }
+        }
+    }
 
 public:
-    void push(const T& data) {
-        Node* newTop = new Node(data);
-        newTop->next = top_;
-        while (!top_.compare_exchange_strong(newTop->next, newTop)) {
-            // repeat until success
+    lfStack() = default;
+    lfStack(const lfStack&) = delete;
+    lfStack& operator=(const lfStack&) = delete;
+
+    ~lfStack() {
+        // no other thread can use the stack anymore
+        Node* cur = top_.load(std::memory_order_acquire);
+        while (cur != nullptr) {
+            Node* next = cur->next;
+            destroyNode(cur);
+            cur = next;
         }
     }
 
+    void push(const T& data) {
+        pushNode(createNode(data));
+    }
+
+    void push(T&& data) {
+        pushNode(createNode(std::move(data)));
+    }
+
     bool pop(T& data) {
-        Node* curTop = top_.load();
-        while (true) {
-            if (curTop == nullptr) { return false; }
-            if (top_.compare_exchange_strong(curTop, curTop->next.load())) {
-                data = curTop->data;
-                // delete curTop;
+        typename Reclaim::Guard guard;
+        Node* top = top_.load(std::memory_order_acquire);
+        while (top != nullptr) {
+            guard.Protect(0, top);
+            // top may have been popped and retired before it was protected
+            Node* cur = top_.load(std::memory_order_acquire);
+            if (cur != top) {
+                top = cur;
+                continue;
+            }
+
+            if (top_.compare_exchange_strong(top, top->next, std::memory_order_acquire,
+                                             std::memory_order_acquire)) {
+                data = std::move(top->data);
+                guard.Reset();
+                Reclaim::Retire(top, destroyNode);
                 return true;
             }
+            if constexpr (EliminationSlots > 0) {
+                if (tryEliminatePop(data)) {
+                    return true;
+                }
+                top = top_.load(std::memory_order_acquire);
+            }
         }
+        return false;
     }
-};
 
+    // Moves [first, last) in as one chain with a single CAS, *(last - 1) ends up on top
+    template <typename Iter>
+    void push_bulk(Iter first, Iter last) {
+        if (first == last) {
+            return;
+        }
+        Node* bottom = createNode(std::move(*first));
+        Node* top = bottom;
+        try {
+            for (++first; first != last; ++first) {
+                Node* node = createNode(std::move(*first));
+                node->next = top;
+                top = node;
+            }
+        } catch (...) {
+            while (top != nullptr) {
+                Node* next = top->next;
+                destroyNode(top);
+                top = next;
+            }
+            throw;
+        }
+
+        Node* cur = top_.load(std::memory_order_relaxed);
+        do {
+            bottom->next = cur;
+        } while (!top_.compare_exchange_weak(cur, top, std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    // Detaches the whole stack with one exchange and moves it out top first, returns the count
+    template <typename OutIt>
+    size_t pop_all(OutIt out) {
+        Node* cur = top_.exchange(nullptr, std::memory_order_acquire);
+        size_t taken = 0;
+        while (cur != nullptr) {
+            // concurrent pops may still read next of nodes they protected
+            Node* next = cur->next;
+            *out++ = std::move(cur->data);
+            Reclaim::Retire(cur, destroyNode);
+            cur = next;
+            ++taken;
+        }
+        return taken;
+    }
+
+    bool empty() const {
+        return top_.load(std::memory_order_acquire) == nullptr;
+    }
+};
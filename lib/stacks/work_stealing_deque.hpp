@@ -0,0 +1,158 @@
+#pragma once
+
+#include <lib/common/common.h>
+
+// Chase-Lev work-stealing deque, with the memory orderings of Le, Pop, Cohen and Zappa Nardelli
+// ("Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP'13).
+//
+// One owner thread pushes and pops at the bottom, LIFO, without any CAS except when it competes
+// for the last item. Any other thread steals from the top, FIFO, with one CAS per item. The
+// circular array doubles when the owner pushes into a full one; thieves may still read the old
+// array, so old arrays are kept until the deque is destroyed (together at most as large as the
+// current one). Items are read by thieves before they win the CAS, so T must be trivially
+// copyable - typically a pointer to a task.
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "thieves copy items they may not get to own");
+
+private:
+    struct Array {
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> cells;
+
+        explicit Array(int64_t capacity): mask(capacity - 1), cells(new std::atomic<T>[capacity]) {
+        }
+
+        int64_t capacity() const {
+            return mask + 1;
+        }
+
+        T get(int64_t index) const {
+            return cells[index & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T item) {
+            cells[index & mask].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(CACHE_LINE) std::atomic<int64_t> top_{0};
+    alignas(CACHE_LINE) std::atomic<int64_t> bottom_{0};
+    alignas(CACHE_LINE) std::atomic<Array*> array_;
+
+    // owner-only: arrays replaced by grow(), thieves may still be reading them
+    std::vector<std::unique_ptr<Array>> retired_;
+
+    Array* grow(Array* old, int64_t top, int64_t bottom) {
+        auto bigger = std::make_unique<Array>(2 * old->capacity());
+        for (int64_t i = top; i < bottom; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        Array* fresh = bigger.release();
+        array_.store(fresh, std::memory_order_release);
+        retired_.emplace_back(old);
+        return fresh;
+    }
+
+public:
+    explicit WorkStealingDeque(uint64_t capacity = 64)
+            : array_(new Array(
+                      static_cast<int64_t>(std::bit_ceil(std::max<uint64_t>(capacity, 2))))) {
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    ~WorkStealingDeque() {
+        delete array_.load(std::memory_order_relaxed);
+    }
+
+    // Owner only
+    void push_bottom(T item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Array* array = array_.load(std::memory_order_relaxed);
+        if (bottom - top > array->mask) {
+            array = grow(array, top, bottom);
+        }
+        array->put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only, takes the most recently pushed item
+    bool pop_bottom(T& item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* array = array_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        // pairs with the fence in steal: a thief either sees the smaller bottom or we see its top
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        T candidate = array->get(bottom);
+        if (top < bottom) {
+            item = candidate;
+            return true;
+        }
+
+        // the last item, thieves compete for it on top_
+        bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        if (won) {
+            item = candidate;
+        }
+        return won;
+    }
+
+    // Any thread, takes the oldest item. False if the deque is empty or another thread got the
+    // item first.
+    bool steal(T& item) {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+
+        Array* array = array_.load(std::memory_order_acquire);
+        T candidate = array->get(top);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return false;
+        }
+        item = candidate;
+        return true;
+    }
+
+    // Any thread, steals up to half of the items (at most max) from the top, oldest first, and
+    // returns how many it got. Every item is taken with its own CAS: the owner pops without CAS
+    // while more than one item is left, so a single CAS cannot claim a range safely.
+    template <typename OutIt>
+    size_t steal_half(OutIt out, size_t max = std::numeric_limits<size_t>::max()) {
+        int64_t available = size();
+        size_t want = std::min<size_t>(static_cast<size_t>((available + 1) / 2), max);
+        size_t taken = 0;
+        T item;
+        while (taken < want && steal(item)) {
+            *out++ = item;
+            ++taken;
+        }
+        return taken;
+    }
+
+    // A snapshot, exact only when no other thread works on the deque
+    int64_t size() const {
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        int64_t top = top_.load(std::memory_order_acquire);
+        return std::max<int64_t>(bottom - top, 0);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+};
@@ -0,0 +1,76 @@
+#include <benches/stack_benches/work_stealing.hpp>
+
+// Stress checks for WorkStealingDeque, aborts on the first failure
+
+namespace {
+
+constexpr uint64_t THIEVES = 4;
+constexpr uint64_t ITEMS = 200'000;
+constexpr uint64_t ROUNDS = 20;
+constexpr uint64_t RACES = 100'000;
+
+// Owner pushes and pops in bursts, starting from the smallest array so it keeps growing while
+// thieves read it; every item must be taken exactly once
+void ownerAgainstThieves(bool stealHalf) {
+    for (uint64_t round = 0; round < ROUNDS; ++round) {
+        auto report = bench::workStealing(THIEVES, ITEMS, stealHalf, 2);
+        REQUIRE(report.errors == 0, report.errors, " items lost or taken twice, steal_half = ",
+                stealHalf, ", round ", round);
+    }
+}
+
+// The owner pops the only item while every thief tries to steal it: exactly one must win
+void lastItemRace() {
+    WorkStealingDeque<uint64_t> deque(2);
+    std::atomic<uint64_t> round{0};
+    std::atomic<uint64_t> attempted{0};
+    std::atomic<uint64_t> stolen{0};
+
+    std::vector<std::thread> thieves;
+    for (uint64_t t = 0; t < THIEVES; ++t) {
+        thieves.emplace_back([&] {
+            uint64_t item = 0;
+            for (uint64_t seen = 0; seen < RACES; ++seen) {
+                while (round.load(std::memory_order_acquire) == seen) {
+                    std::this_thread::yield();
+                }
+                if (deque.steal(item)) {
+                    REQUIRE(item == seen, "stole ", item, " in race ", seen);
+                    stolen.fetch_add(1, std::memory_order_relaxed);
+                }
+                attempted.fetch_add(1, std::memory_order_acq_rel);
+            }
+        });
+    }
+
+    uint64_t popped = 0;
+    uint64_t item = 0;
+    for (uint64_t race = 0; race < RACES; ++race) {
+        deque.push_bottom(race);
+        round.store(race + 1, std::memory_order_release);
+        if (deque.pop_bottom(item)) {
+            REQUIRE(item == race, "popped ", item, " in race ", race);
+            ++popped;
+        }
+        while (attempted.load(std::memory_order_acquire) < (race + 1) * THIEVES) {
+            std::this_thread::yield();
+        }
+        REQUIRE(popped + stolen.load(std::memory_order_relaxed) == race + 1,
+                "last item taken ", popped + stolen.load() - race, " times in race ", race);
+        REQUIRE(deque.empty(), "deque not empty after race ", race);
+    }
+
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+}
+
+} // namespace
+
+int main() {
+    ownerAgainstThieves(false);
+    ownerAgainstThieves(true);
+    lastItemRace();
+    INFO("work stealing deque: ok");
+    return 0;
+}